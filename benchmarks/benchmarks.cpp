@@ -1,32 +1,20 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <string>
+#include <unordered_map>
 #include <benchmark/benchmark.h>
-#include "Quadtree.h"
+#include "PairCache.h"
+#include "indexes.hpp"
+#include "perf_counters.hpp"
 
 using namespace quadtree;
 
-struct Node
-{
-    Box<float> box;
-    std::size_t id;
-};
-
-std::vector<Node> generateRandomNodes(std::size_t n)
-{
-    auto generator = std::default_random_engine();
-    auto originDistribution = std::uniform_real_distribution(0.0f, 1.0f);
-    auto sizeDistribution = std::uniform_real_distribution(0.0f, 0.01f);
-    auto nodes = std::vector<Node>(n);
-    for (auto i = std::size_t(0); i < n; ++i)
-    {
-        nodes[i].box.left = originDistribution(generator);
-        nodes[i].box.top = originDistribution(generator);
-        nodes[i].box.width = std::min(1.0f - nodes[i].box.left, sizeDistribution(generator));
-        nodes[i].box.height = std::min(1.0f - nodes[i].box.top, sizeDistribution(generator));
-        nodes[i].id = i;
-    }
-    return nodes;
-}
+using workloads::Node;
+using workloads::Distribution;
 
 std::vector<Node*> query(const Box<float>& box, std::vector<Node>& nodes)
 {
@@ -53,66 +41,589 @@ std::vector<std::pair<Node*, Node*>> findAllIntersections(std::vector<Node>& nod
     return intersections;
 }
 
-void quadtreeBuild(benchmark::State& state)
+// Hardware counters, only when requested on the command line
+std::unique_ptr<PerfCounters> perfCounters;
+
+// Report the allocations made by the counting indexes and the hardware counters during the benchmark loop,
+// per operation. The allocations are only reported when the benchmark counts them.
+class CounterReporter
 {
+public:
+    CounterReporter(benchmark::State& state, std::int64_t nbOperationsPerIteration, bool countAllocations = false) :
+        mState(state), mNbOperationsPerIteration(nbOperationsPerIteration), mCountAllocations(countAllocations)
+    {
+        mHardwareCounters.fill(0.0);
+        resume();
+    }
 
-    auto getBox = [](Node* node)
+    ~CounterReporter()
     {
-        return node->box;
-    };
+        pause();
+        auto nbOperations = static_cast<double>(std::max<std::int64_t>(mState.iterations() * mNbOperationsPerIteration, 1));
+        if (mCountAllocations)
+        {
+            mState.counters["allocs/op"] = static_cast<double>(mAllocations.allocations) / nbOperations;
+            mState.counters["bytes/op"] = static_cast<double>(mAllocations.bytes) / nbOperations;
+        }
+        if (perfCounters)
+        {
+            for (auto i = std::size_t(0); i < PerfCounters::NbCounters; ++i)
+            {
+                if (perfCounters->isAvailable(i))
+                    mState.counters[std::string(PerfCounters::getName(i)) + "/op"] = mHardwareCounters[i] / nbOperations;
+            }
+        }
+    }
+
+    void pause()
+    {
+        if (perfCounters)
+        {
+            auto values = perfCounters->read();
+            for (auto i = std::size_t(0); i < PerfCounters::NbCounters; ++i)
+                mHardwareCounters[i] += values[i] - mHardwareStart[i];
+        }
+        mAllocations += getAllocationCounters() - mAllocationStart;
+    }
+
+    void resume()
+    {
+        mAllocationStart = getAllocationCounters();
+        if (perfCounters)
+            mHardwareStart = perfCounters->read();
+    }
+
+private:
+    benchmark::State& mState;
+    std::int64_t mNbOperationsPerIteration;
+    bool mCountAllocations;
+    AllocationCounters mAllocationStart;
+    AllocationCounters mAllocations;
+    PerfCounters::Values mHardwareStart;
+    PerfCounters::Values mHardwareCounters;
+};
+
+template <typename Index>
+void indexBuild(benchmark::State& state, Distribution distribution)
+{
     auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
-    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range()), distribution);
+    auto counters = CounterReporter(state, state.range(), CountsAllocations<Index>::value);
     for (auto _ : state)
     {
-        auto intersections = std::vector<std::vector<Node*>>(nodes.size());
-        auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+        auto index = Index(box);
         for (auto& node : nodes)
-            quadtree.add(&node);
+            index.add(&node);
     }
 }
 
-void quadtreeQuery(benchmark::State& state)
+// Build with the nodes and the buffers reserved ahead, out of the timed section
+template <typename Index>
+void quadtreeReservedBuild(benchmark::State& state, Distribution distribution)
 {
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto counters = CounterReporter(state, state.range(0), CountsAllocations<Index>::value);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        counters.pause();
+        auto quadtree = Index(box);
+        if (state.range(1) != 0)
+            quadtree.reserve(nodes.size());
+        counters.resume();
+        state.ResumeTiming();
+        for (auto& node : nodes)
+            quadtree.add(&node);
+    }
+}
 
-    auto getBox = [](Node* node)
+template <typename Index>
+void indexQuery(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range()), distribution);
+    auto counters = CounterReporter(state, state.range(), CountsAllocations<Index>::value);
+    for (auto _ : state)
     {
-        return node->box;
-    };
+        auto intersections = std::vector<typename Index::template vector_type<Node*>>(nodes.size());
+        auto index = Index(box);
+        for (auto& node : nodes)
+            index.add(&node);
+        for (const auto& node : nodes)
+            intersections[node.id] = index.query(node.box);
+    }
+}
 
+template <typename Index>
+void indexFindAllIntersections(benchmark::State& state, Distribution distribution)
+{
     auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
-    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range()), distribution);
+    auto counters = CounterReporter(state, state.range(), CountsAllocations<Index>::value);
     for (auto _ : state)
     {
-        auto intersections = std::vector<std::vector<Node*>>(nodes.size());
-        auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+        auto index = Index(box);
         for (auto& node : nodes)
-            quadtree.add(&node);
+            index.add(&node);
+        auto intersections = index.findAllIntersections();
+    }
+}
+
+// findAllIntersections spread over several resumes of a cursor, each visiting at most a number of nodes
+void quadtreeResumableFindAllIntersections(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto quadtree = QuadtreeIndex(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto maxNodes = static_cast<std::size_t>(state.range(1));
+    auto nbResumes = std::size_t(0);
+    auto counters = CounterReporter(state, 1);
+    for (auto _ : state)
+    {
+        auto intersections = QuadtreeIndex::vector_type<std::pair<Node*, Node*>>();
+        auto cursor = quadtree.startFindAllIntersections();
+        do
+            ++nbResumes;
+        while (!cursor.resume(maxNodes, intersections));
+        benchmark::DoNotOptimize(intersections);
+    }
+    state.counters["resumes"] = static_cast<double>(nbResumes) / static_cast<double>(std::max<std::int64_t>(state.iterations(), 1));
+}
+
+template <typename Index>
+void indexFindClosest(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range()), distribution);
+    auto index = Index(box);
+    for (auto& node : nodes)
+        index.add(&node);
+    auto counters = CounterReporter(state, state.range(), CountsAllocations<Index>::value);
+    for (auto _ : state)
+    {
         for (const auto& node : nodes)
-            intersections[node.id] = quadtree.query(node.box);
+            benchmark::DoNotOptimize(index.findClosest(node.box,
+                [&node](Node* other, const Box<float>&){ return other != &node; }));
     }
 }
 
-void quadtreeFindAllIntersections(benchmark::State& state)
+// Where the nearest queries are made, the values are in the top left quarter of the area
+enum class QueryRegion
 {
+    Inside, // Among the values
+    Empty, // In the empty bottom right quarter of the area
+    Outside // Out of the area
+};
 
-    auto getBox = [](Node* node)
+template <typename Index>
+void indexFindClosestQueries(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto index = Index(box);
+    for (auto& node : nodes)
     {
-        return node->box;
-    };
+        node.box = Box(node.box.left / 2.0f, node.box.top / 2.0f, node.box.width / 2.0f, node.box.height / 2.0f);
+        index.add(&node);
+    }
+    // Query points
+    auto region = static_cast<QueryRegion>(state.range(1));
+    auto origin = region == QueryRegion::Inside ? Vector2(0.0f, 0.0f) :
+        (region == QueryRegion::Empty ? Vector2(0.75f, 0.75f) : Vector2(1.25f, 0.0f));
+    auto size = region == QueryRegion::Inside ? Vector2(0.5f, 0.5f) : Vector2(0.25f, 0.25f);
+    auto generator = std::default_random_engine();
+    auto xDistribution = std::uniform_real_distribution<float>(origin.x, origin.x + size.x);
+    auto yDistribution = std::uniform_real_distribution<float>(origin.y, origin.y + size.y);
+    auto queries = std::vector<Box<float>>(1000);
+    for (auto& query : queries)
+        query = Box(xDistribution(generator), yDistribution(generator), 0.0f, 0.0f);
+    // Percentage of the values accepted by the predicate, no predicate at all for 100%
+    auto acceptance = static_cast<std::size_t>(state.range(2));
+    auto predicate = [acceptance](Node* node, const Box<float>&){ return node->id % 100 < acceptance; };
+    auto counters = CounterReporter(state, static_cast<std::int64_t>(queries.size()), CountsAllocations<Index>::value);
+    for (auto _ : state)
+    {
+        for (const auto& query : queries)
+        {
+            if (acceptance < 100)
+                benchmark::DoNotOptimize(index.findClosest(query, predicate));
+            else
+                benchmark::DoNotOptimize(index.findClosest(query));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(queries.size()));
+}
+
+void quadtreeLocate(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto quadtree = QuadtreeIndex(box);
+    quadtree.setHashingEnabled(state.range(1) != 0);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto counters = CounterReporter(state, state.range(0));
+    for (auto _ : state)
+    {
+        for (const auto& node : nodes)
+            benchmark::DoNotOptimize(quadtree.locate(node.box.getCenter()));
+    }
+}
+
+void quadtreeNeighbours(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range()), distribution);
+    auto quadtree = QuadtreeIndex(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto leaves = std::vector<QuadtreeIndex::LocationalCode>();
+    quadtree.forEachLeaf([&leaves](auto code, const auto&, const auto&){ leaves.push_back(code); });
+    auto counters = CounterReporter(state, static_cast<std::int64_t>(leaves.size()));
+    for (auto _ : state)
+    {
+        auto nbValues = std::size_t(0);
+        for (auto leaf : leaves)
+            quadtree.forEachNeighbour(leaf, [&nbValues](auto, const auto&, const auto& values){ nbValues += values.size(); });
+        benchmark::DoNotOptimize(nbValues);
+    }
+}
+
+void quadtreeQueryLod(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto quadtree = QuadtreeIndex(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto maxDepth = static_cast<std::size_t>(state.range(1));
+    auto counters = CounterReporter(state, 1);
+    for (auto _ : state)
+    {
+        auto count = std::size_t(0);
+        quadtree.queryLod(box, maxDepth, [&count](const auto& summary){ count += summary.count; });
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+void quadtreeSample(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range()), distribution);
+    auto quadtree = QuadtreeIndex(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto generator = std::default_random_engine();
+    auto sampleBox = Box(0.1f, 0.1f, 0.5f, 0.5f);
+    auto counters = CounterReporter(state, 1);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(quadtree.sample(sampleBox, 100, generator));
+}
+
+// Dynamic workloads, one iteration is one tick
+
+template <typename Index>
+void indexRemove(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range()), distribution);
+    auto counters = CounterReporter(state, state.range(), CountsAllocations<Index>::value);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        counters.pause();
+        auto index = Index(box);
+        for (auto& node : nodes)
+            index.add(&node);
+        counters.resume();
+        state.ResumeTiming();
+        for (auto& node : nodes)
+            index.remove(&node);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range());
+}
+
+template <typename Index>
+void indexMove(benchmark::State& state, Distribution distribution)
+{
     auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
-    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto index = Index(box);
+    index.setHashingEnabled(state.range(2) != 0);
+    for (auto& node : nodes)
+        index.add(&node);
+    // Displacement in thousandths of the side of the area
+    auto maxDisplacement = static_cast<float>(state.range(1)) / 1000.0f;
+    auto generator = std::default_random_engine();
+    auto displacementDistribution = std::uniform_real_distribution<float>(-maxDisplacement, maxDisplacement);
+    auto counters = CounterReporter(state, state.range(0), CountsAllocations<Index>::value);
     for (auto _ : state)
     {
-        auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
         for (auto& node : nodes)
+        {
+            auto oldBox = node.box;
+            moveNode(node, generator, displacementDistribution);
+            index.update(&node, oldBox);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Index>
+void indexChurn(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto n = static_cast<std::size_t>(state.range(0));
+    auto nodes = workloads::generateNodes(n, distribution);
+    // Boxes of the spawned nodes, drawn from the same distribution
+    auto parameters = workloads::Parameters();
+    parameters.distribution = distribution;
+    parameters.seed = 1;
+    auto spawns = workloads::generateNodes(n, parameters);
+    auto nextSpawn = std::size_t(0);
+    auto index = Index(box);
+    for (auto& node : nodes)
+        index.add(&node);
+    // Percentage of the nodes despawned and spawned at each tick
+    auto nbChurned = n * static_cast<std::size_t>(state.range(1)) / 100;
+    auto generator = std::default_random_engine();
+    auto nodeDistribution = std::uniform_int_distribution<std::size_t>(0, n - 1);
+    auto counters = CounterReporter(state, static_cast<std::int64_t>(nbChurned), CountsAllocations<Index>::value);
+    for (auto _ : state)
+    {
+        for (auto i = std::size_t(0); i < nbChurned; ++i)
+        {
+            auto& node = nodes[nodeDistribution(generator)];
+            index.remove(&node);
+            node.box = spawns[nextSpawn].box;
+            nextSpawn = (nextSpawn + 1) % n;
+            index.add(&node);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(nbChurned));
+}
+
+// Queries on a tree scattered by churn, compacted in each order: none, breadth-first or van Emde Boas
+template <typename Index>
+void quadtreeCompactedQuery(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto n = static_cast<std::size_t>(state.range(0));
+    auto nodes = workloads::generateNodes(n, distribution);
+    auto parameters = workloads::Parameters();
+    parameters.distribution = distribution;
+    parameters.seed = 1;
+    auto spawns = workloads::generateNodes(n, parameters);
+    auto quadtree = Index(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto generator = std::default_random_engine();
+    auto nodeDistribution = std::uniform_int_distribution<std::size_t>(0, n - 1);
+    for (auto i = std::size_t(0); i < 4 * n; ++i)
+    {
+        auto& node = nodes[nodeDistribution(generator)];
+        quadtree.remove(&node);
+        node.box = spawns[i % n].box;
+        quadtree.add(&node);
+    }
+    if (state.range(1) > 0)
+    {
+        auto order = state.range(1) == 1 ? Index::NodeOrder::BreadthFirst : Index::NodeOrder::VanEmdeBoas;
+        auto duration = quadtree.compact(order);
+        state.counters["compact-us"] = std::chrono::duration<double, std::micro>(duration).count();
+    }
+    auto counters = CounterReporter(state, state.range(0));
+    for (auto _ : state)
+    {
+        auto nbIntersections = std::size_t(0);
+        for (const auto& node : nodes)
+            nbIntersections += quadtree.query(node.box).size();
+        benchmark::DoNotOptimize(nbIntersections);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Frames where 10% of the nodes move before finding all the intersections, the static
+// nodes are in the same quadtree as the moving ones or in the static layer
+void layeredFrame(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto isMoving = [](const Node& node){ return node.id % 10 == 0; };
+    auto layered = state.range(1) != 0;
+    auto quadtree = QuadtreeIndex(box);
+    auto layeredQuadtree = LayeredIndex(box);
+    auto staticValues = std::vector<Node*>();
+    for (auto& node : nodes)
+    {
+        if (!layered)
             quadtree.add(&node);
+        else if (isMoving(node))
+            layeredQuadtree.add(&node);
+        else
+            staticValues.push_back(&node);
+    }
+    layeredQuadtree.buildStatic(staticValues);
+    auto generator = std::default_random_engine();
+    auto displacementDistribution = std::uniform_real_distribution<float>(-0.001f, 0.001f);
+    auto counters = CounterReporter(state, 1);
+    for (auto _ : state)
+    {
+        for (auto& node : nodes)
+        {
+            if (!isMoving(node))
+                continue;
+            auto oldBox = node.box;
+            moveNode(node, generator, displacementDistribution);
+            if (layered)
+                layeredQuadtree.update(&node, oldBox);
+            else
+                quadtree.update(&node, oldBox);
+        }
+        auto nbIntersections = layered ? layeredQuadtree.findAllIntersections().size() :
+            quadtree.findAllIntersections().size();
+        benchmark::DoNotOptimize(nbIntersections);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+struct PairHash
+{
+    std::size_t operator()(const std::pair<Node*, Node*>& pair) const
+    {
+        return std::hash<Node*>()(pair.first) * 31 + std::hash<Node*>()(pair.second);
+    }
+};
+
+// Classification of the pairs of each frame as they begin, persist or end, in a PairCache
+// or in an unordered_map of the canonical pairs to the frame they were last found
+void pairCacheFrame(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto quadtree = QuadtreeIndex(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto cache = PairCache<Node*, int, std::hash<Node*>, std::equal_to<Node*>, std::less<Node*>, CountingAllocator>();
+    auto map = std::unordered_map<std::pair<Node*, Node*>, int, PairHash, std::equal_to<std::pair<Node*, Node*>>,
+        CountingAllocator<std::pair<const std::pair<Node*, Node*>, int>>>();
+    auto frame = 0;
+    auto nbEvents = std::size_t(0);
+    auto generator = std::default_random_engine();
+    auto displacementDistribution = std::uniform_real_distribution<float>(-0.001f, 0.001f);
+    // Only the cache and the map count their allocations
+    auto counters = CounterReporter(state, 1, true);
+    for (auto _ : state)
+    {
+        counters.pause();
+        state.PauseTiming();
+        for (auto& node : nodes)
+        {
+            auto oldBox = node.box;
+            moveNode(node, generator, displacementDistribution);
+            quadtree.update(&node, oldBox);
+        }
         auto intersections = quadtree.findAllIntersections();
+        ++frame;
+        state.ResumeTiming();
+        counters.resume();
+        auto onBegin = [&nbEvents](Node*, Node*, int&){ ++nbEvents; };
+        auto onPersist = [&nbEvents](Node*, Node*, int&){ ++nbEvents; };
+        auto onEnd = [&nbEvents](Node*, Node*, int&){ ++nbEvents; };
+        if (state.range(1) != 0)
+            cache.update(intersections, onBegin, onPersist, onEnd);
+        else
+        {
+            // Same classification as PairCache::update
+            for (const auto& intersection : intersections)
+            {
+                auto pair = std::less<Node*>()(intersection.second, intersection.first) ?
+                    std::make_pair(intersection.second, intersection.first) : intersection;
+                auto it = map.find(pair);
+                if (it == map.end())
+                {
+                    it = map.emplace(pair, frame).first;
+                    onBegin(pair.first, pair.second, it->second);
+                }
+                else if (it->second != frame)
+                {
+                    it->second = frame;
+                    onPersist(pair.first, pair.second, it->second);
+                }
+            }
+            for (auto it = map.begin(); it != map.end();)
+            {
+                if (it->second != frame)
+                {
+                    onEnd(it->first.first, it->first.second, it->second);
+                    it = map.erase(it);
+                }
+                else
+                    ++it;
+            }
+        }
+    }
+    benchmark::DoNotOptimize(nbEvents);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Intersections when only a percentage of the nodes is awake
+void sleepingFindAllIntersections(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto index = SleepingIndex(box);
+    for (auto& node : nodes)
+        index.add(&node, node.id % 100 < static_cast<std::size_t>(state.range(1)));
+    auto counters = CounterReporter(state, 1);
+    for (auto _ : state)
+    {
+        auto intersections = index.findAllIntersections();
+        benchmark::DoNotOptimize(intersections);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Index>
+void indexMixed(benchmark::State& state, Distribution distribution)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range(0)), distribution);
+    auto index = Index(box);
+    for (auto& node : nodes)
+        index.add(&node);
+    // Each node is either moved or queried at each tick, in percentage of writes
+    auto generator = std::default_random_engine();
+    auto writeDistribution = std::bernoulli_distribution(static_cast<double>(state.range(1)) / 100.0);
+    auto isWrite = std::vector<bool>(nodes.size());
+    std::generate(std::begin(isWrite), std::end(isWrite), [&](){ return writeDistribution(generator); });
+    auto displacementDistribution = std::uniform_real_distribution<float>(-0.001f, 0.001f);
+    auto counters = CounterReporter(state, state.range(0), CountsAllocations<Index>::value);
+    for (auto _ : state)
+    {
+        auto nbIntersections = std::size_t(0);
+        for (auto& node : nodes)
+        {
+            if (isWrite[node.id])
+            {
+                auto oldBox = node.box;
+                moveNode(node, generator, displacementDistribution);
+                index.update(&node, oldBox);
+            }
+            else
+                nbIntersections += index.query(node.box).size();
+        }
+        benchmark::DoNotOptimize(nbIntersections);
     }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
 }
 
-void bruteForceQuery(benchmark::State& state)
+void bruteForceQuery(benchmark::State& state, Distribution distribution)
 {
-    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range()), distribution);
     for (auto _ : state)
     {
         auto intersections = std::vector<std::vector<Node*>>(nodes.size());
@@ -121,19 +632,150 @@ void bruteForceQuery(benchmark::State& state)
     }
 }
 
-void bruteForceFindAllIntersections(benchmark::State& state)
+void bruteForceFindAllIntersections(benchmark::State& state, Distribution distribution)
 {
-    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto nodes = workloads::generateNodes(static_cast<std::size_t>(state.range()), distribution);
     for (auto _ : state)
     {
         auto intersections = findAllIntersections(nodes);
     }
 }
 
-BENCHMARK(quadtreeBuild)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
-BENCHMARK(quadtreeQuery)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
-BENCHMARK(quadtreeFindAllIntersections)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
-BENCHMARK(bruteForceQuery)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
-BENCHMARK(bruteForceFindAllIntersections)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+// Register the benchmark once for each distribution of the workloads
+template <typename Function, typename Configure>
+void registerBenchmark(const std::string& name, Function function, Configure configure)
+{
+    for (auto distribution : workloads::Distributions)
+    {
+        auto instance = benchmark::RegisterBenchmark((name + "/" + workloads::getName(distribution)).c_str(),
+            function, distribution);
+        configure(instance->Unit(benchmark::kMicrosecond));
+    }
+}
+
+void registerBenchmarks()
+{
+    auto range = [](std::int64_t first, std::int64_t last)
+    {
+        return [first, last](benchmark::internal::Benchmark* instance){ instance->RangeMultiplier(10)->Range(first, last); };
+    };
+    auto findClosest = [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{1000, 100000}, {0, 1, 2}, {100, 10, 1}})->ArgNames({"n", "region", "acceptance"});
+    };
+    auto move = [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{10000, 100000}, {1, 100}, {0, 1}})->ArgNames({"n", "displacement", "hashing"});
+    };
+    auto churn = [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{10000, 100000}, {1, 10, 50}})->ArgNames({"n", "churn"});
+    };
+    auto compact = [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{10000, 100000}, {0, 1, 2}})->ArgNames({"n", "order"});
+    };
+    auto layered = [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{10000, 100000}, {0, 1}})->ArgNames({"n", "layered"});
+    };
+    auto pairCache = [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{10000, 100000}, {0, 1}})->ArgNames({"n", "cache"});
+    };
+    auto sleeping = [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{10000, 100000}, {100, 10, 1}})->ArgNames({"n", "awake"});
+    };
+    auto mixed = [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{10000, 100000}, {0, 10, 50, 90}})->ArgNames({"n", "writes"});
+    };
+    auto reserved = [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{1000, 100000}, {0, 1}})->ArgNames({"n", "reserve"});
+    };
+    registerBenchmark("indexBuild<QuadtreeIndex>", indexBuild<QuadtreeIndex>, range(100, 100000));
+    registerBenchmark("indexBuild<GridIndex>", indexBuild<GridIndex>, range(100, 100000));
+    registerBenchmark("indexBuild<HybridIndex>", indexBuild<HybridIndex>, range(100, 100000));
+    registerBenchmark("indexBuild<CountingQuadtreeIndex>", indexBuild<CountingQuadtreeIndex>, range(100, 100000));
+    registerBenchmark("indexBuild<CountingGridIndex>", indexBuild<CountingGridIndex>, range(100, 100000));
+    registerBenchmark("indexBuild<CountingHybridIndex>", indexBuild<CountingHybridIndex>, range(100, 100000));
+    registerBenchmark("quadtreeReservedBuild<QuadtreeIndex>", quadtreeReservedBuild<QuadtreeIndex>, reserved);
+    registerBenchmark("quadtreeReservedBuild<CountingQuadtreeIndex>", quadtreeReservedBuild<CountingQuadtreeIndex>, reserved);
+    registerBenchmark("indexQuery<QuadtreeIndex>", indexQuery<QuadtreeIndex>, range(100, 100000));
+    registerBenchmark("indexQuery<GridIndex>", indexQuery<GridIndex>, range(100, 100000));
+    registerBenchmark("indexQuery<HybridIndex>", indexQuery<HybridIndex>, range(100, 100000));
+    registerBenchmark("indexFindAllIntersections<QuadtreeIndex>", indexFindAllIntersections<QuadtreeIndex>, range(100, 100000));
+    registerBenchmark("indexFindAllIntersections<GridIndex>", indexFindAllIntersections<GridIndex>, range(100, 100000));
+    registerBenchmark("indexFindAllIntersections<HybridIndex>", indexFindAllIntersections<HybridIndex>, range(100, 100000));
+    registerBenchmark("quadtreeResumableFindAllIntersections", quadtreeResumableFindAllIntersections,
+        [](benchmark::internal::Benchmark* instance)
+        {
+            instance->ArgsProduct({{1000, 100000}, {1, 16, 256}})->ArgNames({"n", "nodes"});
+        });
+    registerBenchmark("indexFindClosest<QuadtreeIndex>", indexFindClosest<QuadtreeIndex>, range(100, 100000));
+    registerBenchmark("indexFindClosest<GridIndex>", indexFindClosest<GridIndex>, range(100, 100000));
+    registerBenchmark("indexFindClosest<HybridIndex>", indexFindClosest<HybridIndex>, range(100, 100000));
+    registerBenchmark("indexFindClosestQueries<QuadtreeIndex>", indexFindClosestQueries<QuadtreeIndex>, findClosest);
+    registerBenchmark("indexFindClosestQueries<GridIndex>", indexFindClosestQueries<GridIndex>, findClosest);
+    registerBenchmark("indexFindClosestQueries<HybridIndex>", indexFindClosestQueries<HybridIndex>, findClosest);
+    registerBenchmark("quadtreeLocate", quadtreeLocate, [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{1000, 10000, 100000}, {0, 1}})->ArgNames({"n", "hashing"});
+    });
+    registerBenchmark("quadtreeNeighbours", quadtreeNeighbours, range(1000, 100000));
+    registerBenchmark("quadtreeQueryLod", quadtreeQueryLod, [](benchmark::internal::Benchmark* instance)
+    {
+        instance->ArgsProduct({{10000, 100000}, {2, 4, 8}})->ArgNames({"n", "depth"});
+    });
+    registerBenchmark("quadtreeSample", quadtreeSample, range(1000, 1000000));
+    registerBenchmark("indexRemove<QuadtreeIndex>", indexRemove<QuadtreeIndex>, range(1000, 100000));
+    registerBenchmark("indexRemove<GridIndex>", indexRemove<GridIndex>, range(1000, 100000));
+    registerBenchmark("indexRemove<HybridIndex>", indexRemove<HybridIndex>, range(1000, 100000));
+    registerBenchmark("indexMove<QuadtreeIndex>", indexMove<QuadtreeIndex>, move);
+    registerBenchmark("indexMove<HybridIndex>", indexMove<HybridIndex>, move);
+    registerBenchmark("indexChurn<QuadtreeIndex>", indexChurn<QuadtreeIndex>, churn);
+    registerBenchmark("indexChurn<GridIndex>", indexChurn<GridIndex>, churn);
+    registerBenchmark("indexChurn<HybridIndex>", indexChurn<HybridIndex>, churn);
+    registerBenchmark("indexRemove<CountingQuadtreeIndex>", indexRemove<CountingQuadtreeIndex>, range(1000, 100000));
+    registerBenchmark("indexRemove<CountingGridIndex>", indexRemove<CountingGridIndex>, range(1000, 100000));
+    registerBenchmark("indexRemove<CountingHybridIndex>", indexRemove<CountingHybridIndex>, range(1000, 100000));
+    registerBenchmark("indexMove<CountingQuadtreeIndex>", indexMove<CountingQuadtreeIndex>, move);
+    registerBenchmark("indexMove<CountingHybridIndex>", indexMove<CountingHybridIndex>, move);
+    registerBenchmark("indexChurn<CountingQuadtreeIndex>", indexChurn<CountingQuadtreeIndex>, churn);
+    registerBenchmark("indexChurn<CountingGridIndex>", indexChurn<CountingGridIndex>, churn);
+    registerBenchmark("indexChurn<CountingHybridIndex>", indexChurn<CountingHybridIndex>, churn);
+    registerBenchmark("quadtreeCompactedQuery<QuadtreeIndex>", quadtreeCompactedQuery<QuadtreeIndex>, compact);
+    registerBenchmark("quadtreeCompactedQuery<BlockQuadtreeIndex>", quadtreeCompactedQuery<BlockQuadtreeIndex>, compact);
+    registerBenchmark("layeredFrame", layeredFrame, layered);
+    registerBenchmark("pairCacheFrame", pairCacheFrame, pairCache);
+    registerBenchmark("sleepingFindAllIntersections", sleepingFindAllIntersections, sleeping);
+    registerBenchmark("indexMixed<QuadtreeIndex>", indexMixed<QuadtreeIndex>, mixed);
+    registerBenchmark("indexMixed<HybridIndex>", indexMixed<HybridIndex>, mixed);
+    registerBenchmark("bruteForceQuery", bruteForceQuery, range(100, 10000));
+    registerBenchmark("bruteForceFindAllIntersections", bruteForceFindAllIntersections, range(100, 10000));
+}
 
-BENCHMARK_MAIN()
\ No newline at end of file
+// Pass --hardware_counters to report the hardware counters available on this host
+int main(int argc, char** argv)
+{
+    auto nbArguments = 1;
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--hardware_counters") == 0)
+            perfCounters = std::make_unique<PerfCounters>();
+        else
+            argv[nbArguments++] = argv[i];
+    }
+    argc = nbArguments;
+    if (perfCounters && !perfCounters->isAnyAvailable())
+        std::cerr << "Hardware counters are unavailable on this host, they are not reported\n";
+    registerBenchmarks();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
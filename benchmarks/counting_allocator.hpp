@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+// Allocations made through CountingAllocator and CountingMakeUnique on the current thread
+struct AllocationCounters
+{
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+    std::size_t bytes = 0;
+
+    AllocationCounters& operator+=(const AllocationCounters& other)
+    {
+        allocations += other.allocations;
+        deallocations += other.deallocations;
+        bytes += other.bytes;
+        return *this;
+    }
+
+    AllocationCounters operator-(const AllocationCounters& other) const
+    {
+        auto counters = AllocationCounters();
+        counters.allocations = allocations - other.allocations;
+        counters.deallocations = deallocations - other.deallocations;
+        counters.bytes = bytes - other.bytes;
+        return counters;
+    }
+};
+
+inline AllocationCounters& getAllocationCounters()
+{
+    static thread_local auto counters = AllocationCounters();
+    return counters;
+}
+
+template <typename T>
+class CountingAllocator
+{
+public:
+    using value_type = T;
+
+    CountingAllocator() noexcept = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) noexcept
+    {
+
+    }
+
+    T* allocate(std::size_t n)
+    {
+        auto& counters = getAllocationCounters();
+        ++counters.allocations;
+        counters.bytes += n * sizeof(T);
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept
+    {
+        ++getAllocationCounters().deallocations;
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>&) const noexcept
+    {
+        return false;
+    }
+};
+
+// Deallocations of the objects are not counted, they go through the default deleter
+template <typename T>
+struct CountingMakeUnique
+{
+    template <typename... Args>
+    std::unique_ptr<T> operator() (Args&&... args)
+    {
+        auto& counters = getAllocationCounters();
+        ++counters.allocations;
+        counters.bytes += sizeof(T);
+        return std::make_unique<T>(std::forward<Args>(args)...);
+    }
+};
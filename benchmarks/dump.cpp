@@ -0,0 +1,90 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Trace.h"
+#include "TreeDump.h"
+#include "indexes.hpp"
+
+// Write the nodes of a quadtree built from a distribution as an SVG or a JSON, the
+// queries of a trace can be counted in the nodes to draw a heatmap
+//
+// Usage: dump [--n=<number of values>] [--distribution=<name>] [--trace=<trace>] [--svg=<file>] [--json=<file>]
+
+using namespace quadtree;
+
+using workloads::Distribution;
+
+int main(int argc, char** argv)
+{
+    auto n = std::size_t(10000);
+    auto distribution = Distribution::Uniform;
+    auto tracePath = std::string();
+    auto svgPath = std::string();
+    auto jsonPath = std::string();
+    auto usage = [argv]()
+    {
+        std::cerr << "Usage: " << argv[0] << " [--n=<number of values>] [--distribution=<name>] [--trace=<trace>]"
+            " [--svg=<file>] [--json=<file>]\n";
+        return 1;
+    };
+    for (auto i = 1; i < argc; ++i)
+    {
+        auto argument = std::string(argv[i]);
+        if (argument.compare(0, 4, "--n=") == 0)
+            n = std::stoul(argument.substr(4));
+        else if (argument.compare(0, 15, "--distribution=") == 0)
+        {
+            auto name = argument.substr(15);
+            auto it = std::find_if(std::begin(workloads::Distributions), std::end(workloads::Distributions),
+                [&name](Distribution d){ return name == workloads::getName(d); });
+            if (it == std::end(workloads::Distributions))
+                return usage();
+            distribution = *it;
+        }
+        else if (argument.compare(0, 8, "--trace=") == 0)
+            tracePath = argument.substr(8);
+        else if (argument.compare(0, 6, "--svg=") == 0)
+            svgPath = argument.substr(6);
+        else if (argument.compare(0, 7, "--json=") == 0)
+            jsonPath = argument.substr(7);
+        else
+            return usage();
+    }
+    if (svgPath.empty() && jsonPath.empty())
+        return usage();
+    auto nodes = workloads::generateNodes(n, distribution);
+    auto quadtree = QuadtreeIndex(Box(0.0f, 0.0f, 1.0f, 1.0f));
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto dump = TreeDump<float>(quadtree);
+    auto colouring = TreeDump<float>::Colouring::Values;
+    if (!tracePath.empty())
+    {
+        auto file = std::ifstream(tracePath, std::ios::binary);
+        auto reader = TraceReader<float>(file);
+        if (!reader.isValid())
+        {
+            std::cerr << "Invalid trace: " << tracePath << '\n';
+            return 1;
+        }
+        auto event = TraceEvent<float>();
+        while (reader.read(event))
+        {
+            if (event.operation == TraceOperation::Query)
+                dump.addQuery(event.box);
+        }
+        colouring = TreeDump<float>::Colouring::Queries;
+    }
+    if (!svgPath.empty())
+    {
+        auto file = std::ofstream(svgPath);
+        dump.writeSvg(file, colouring);
+    }
+    if (!jsonPath.empty())
+    {
+        auto file = std::ofstream(jsonPath);
+        dump.writeJson(file);
+    }
+    return 0;
+}
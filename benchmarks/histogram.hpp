@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Log-linear histogram in the style of HdrHistogram: values below 2^SubBucketBits are exact,
+// larger values are bucketed with a relative error below 2^-SubBucketBits
+class Histogram
+{
+public:
+    static constexpr std::size_t SubBucketBits = 7;
+    static constexpr std::size_t SubBucketCount = std::size_t(1) << SubBucketBits;
+
+    Histogram() : mCounts((64 - SubBucketBits + 1) * SubBucketCount)
+    {
+
+    }
+
+    void record(std::uint64_t value)
+    {
+        ++mCounts[getIndex(value)];
+        ++mCount;
+        mSum += static_cast<double>(value);
+        mMin = std::min(mMin, value);
+        mMax = std::max(mMax, value);
+    }
+
+    void merge(const Histogram& other)
+    {
+        for (auto i = std::size_t(0); i < mCounts.size(); ++i)
+            mCounts[i] += other.mCounts[i];
+        mCount += other.mCount;
+        mSum += other.mSum;
+        mMin = std::min(mMin, other.mMin);
+        mMax = std::max(mMax, other.mMax);
+    }
+
+    std::uint64_t getCount() const
+    {
+        return mCount;
+    }
+
+    std::uint64_t getMin() const
+    {
+        return mCount > 0 ? mMin : 0;
+    }
+
+    std::uint64_t getMax() const
+    {
+        return mMax;
+    }
+
+    double getMean() const
+    {
+        return mCount > 0 ? mSum / static_cast<double>(mCount) : 0.0;
+    }
+
+    // Smallest bucket bound such that percentile % of the values are below or equal
+    std::uint64_t getPercentile(double percentile) const
+    {
+        if (mCount == 0)
+            return 0;
+        auto target = static_cast<std::uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(mCount)));
+        target = std::min(std::max(target, std::uint64_t(1)), mCount);
+        auto count = std::uint64_t(0);
+        for (auto i = std::size_t(0); i < mCounts.size(); ++i)
+        {
+            count += mCounts[i];
+            if (count >= target)
+                return std::min(getUpperBound(i), mMax);
+        }
+        return mMax;
+    }
+
+private:
+    std::vector<std::uint64_t> mCounts;
+    std::uint64_t mCount = 0;
+    double mSum = 0.0;
+    std::uint64_t mMin = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t mMax = 0;
+
+    static std::size_t getIndex(std::uint64_t value)
+    {
+        if (value < SubBucketCount)
+            return value;
+        auto exponent = std::size_t(0);
+        while ((value >> exponent) >= 2 * SubBucketCount)
+            ++exponent;
+        return exponent * SubBucketCount + (value >> exponent);
+    }
+
+    static std::uint64_t getUpperBound(std::size_t index)
+    {
+        if (index < 2 * SubBucketCount)
+            return index;
+        auto exponent = index / SubBucketCount - 1;
+        auto subBucket = index - exponent * SubBucketCount;
+        return ((subBucket + 1) << exponent) - 1;
+    }
+};
+
+// Name of a percentile, p99.9 for 99.9
+inline std::string getPercentileName(double percentile)
+{
+    auto name = std::to_string(percentile);
+    name.erase(name.find_last_not_of('0') + 1);
+    if (name.back() == '.')
+        name.pop_back();
+    return "p" + name;
+}
+
+// Time stamp counter when available, its frequency is calibrated against steady_clock
+class Clock
+{
+public:
+    Clock()
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto startTicks = now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto ticks = now() - startTicks;
+        auto duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        mNanosecondsPerTick = ticks > 0 ? duration / static_cast<double>(ticks) : 1.0;
+    }
+
+    std::uint64_t now() const
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    std::uint64_t toNanoseconds(std::uint64_t ticks) const
+    {
+        return static_cast<std::uint64_t>(static_cast<double>(ticks) * mNanosecondsPerTick);
+    }
+
+private:
+    double mNanosecondsPerTick;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <type_traits>
+#include "BlockMakeUnique.h"
+#include "Grid.h"
+#include "counting_allocator.hpp"
+#include "LayeredQuadtree.h"
+#include "Quadtree.h"
+#include "SleepingQuadtree.h"
+#include "Workloads.h"
+
+struct GetBox
+{
+    quadtree::Box<float> operator()(workloads::Node* node) const
+    {
+        return node->box;
+    }
+};
+
+using QuadtreeIndex = quadtree::Quadtree<workloads::Node*, GetBox>;
+using GridIndex = quadtree::Grid<workloads::Node*, GetBox>;
+using HybridIndex = quadtree::Quadtree<workloads::Node*, GetBox, std::equal_to<workloads::Node*>, float, std::allocator,
+    quadtree::detail::StdMakeUnique, 8>;
+using LayeredIndex = quadtree::LayeredQuadtree<workloads::Node*, GetBox>;
+using SleepingIndex = quadtree::SleepingQuadtree<workloads::Node*, GetBox>;
+// Nodes allocated in blocks, contiguous once compacted
+using BlockQuadtreeIndex = quadtree::Quadtree<workloads::Node*, GetBox, std::equal_to<workloads::Node*>, float,
+    std::allocator, quadtree::BlockMakeUnique>;
+
+// Same indexes counting their allocations, at the cost of a thread local increment
+// per allocation, their timings are not comparable with the ones of the indexes above
+using CountingQuadtreeIndex = quadtree::Quadtree<workloads::Node*, GetBox, std::equal_to<workloads::Node*>, float,
+    CountingAllocator, CountingMakeUnique>;
+using CountingGridIndex = quadtree::Grid<workloads::Node*, GetBox, std::equal_to<workloads::Node*>, float,
+    CountingAllocator>;
+using CountingHybridIndex = quadtree::Quadtree<workloads::Node*, GetBox, std::equal_to<workloads::Node*>, float,
+    CountingAllocator, CountingMakeUnique, 8>;
+
+template <typename Index>
+using CountsAllocations = std::is_same<typename Index::template vector_type<int>::allocator_type,
+    CountingAllocator<int>>;
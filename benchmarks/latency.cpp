@@ -0,0 +1,168 @@
+#include <array>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "histogram.hpp"
+#include "indexes.hpp"
+
+// Latency of the individual operations, in percentiles per index, distribution and operation
+//
+// Usage: latency [--n=<number of values>] [--json]
+
+using namespace quadtree;
+
+using workloads::Node;
+using workloads::Distribution;
+
+struct Result
+{
+    std::string index;
+    std::string distribution;
+    std::string operation;
+    Histogram histogram;
+};
+
+constexpr auto Percentiles = std::array<double, 5>{50.0, 90.0, 99.0, 99.9, 99.99};
+
+// The results of the queries go there to not be optimized away
+volatile std::size_t sink = 0;
+
+class Stopwatch
+{
+public:
+    Stopwatch(const Clock& clock, std::vector<Result>& results) : mClock(clock), mResults(results)
+    {
+
+    }
+
+    template <typename F>
+    void time(F&& f)
+    {
+        auto start = mClock.now();
+        f();
+        mDurations.push_back(mClock.now() - start);
+    }
+
+    void flush(const std::string& index, Distribution distribution, const std::string& operation)
+    {
+        auto result = Result{index, workloads::getName(distribution), operation, Histogram()};
+        for (auto duration : mDurations)
+            result.histogram.record(mClock.toNanoseconds(duration));
+        mResults.push_back(std::move(result));
+        mDurations.clear();
+    }
+
+private:
+    const Clock& mClock;
+    std::vector<Result>& mResults;
+    std::vector<std::uint64_t> mDurations;
+};
+
+template <typename Index>
+void measure(const std::string& name, Distribution distribution, std::size_t n, Stopwatch& stopwatch)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = workloads::generateNodes(n, distribution);
+    auto index = Index(box);
+    auto generator = std::default_random_engine();
+    // Add
+    for (auto& node : nodes)
+        stopwatch.time([&](){ index.add(&node); });
+    stopwatch.flush(name, distribution, "add");
+    // Query
+    for (const auto& node : nodes)
+        stopwatch.time([&](){ sink = sink + index.query(node.box).size(); });
+    stopwatch.flush(name, distribution, "query");
+    // Find closest to random points
+    auto pointDistribution = std::uniform_real_distribution<float>(0.0f, 1.0f);
+    for (auto i = std::size_t(0); i < n; ++i)
+    {
+        auto point = Box(pointDistribution(generator), pointDistribution(generator), 0.0f, 0.0f);
+        stopwatch.time([&](){ sink = sink + (index.findClosest(point) != nullptr ? 1 : 0); });
+    }
+    stopwatch.flush(name, distribution, "findClosest");
+    // Update after a small move
+    auto displacementDistribution = std::uniform_real_distribution<float>(-0.001f, 0.001f);
+    for (auto& node : nodes)
+    {
+        auto oldBox = node.box;
+        moveNode(node, generator, displacementDistribution);
+        stopwatch.time([&](){ index.update(&node, oldBox); });
+    }
+    stopwatch.flush(name, distribution, "update");
+    // Remove in random order, merges are triggered along the way
+    auto order = std::vector<Node*>(nodes.size());
+    std::transform(std::begin(nodes), std::end(nodes), std::begin(order), [](Node& node){ return &node; });
+    std::shuffle(std::begin(order), std::end(order), generator);
+    for (auto node : order)
+        stopwatch.time([&](){ index.remove(node); });
+    stopwatch.flush(name, distribution, "remove");
+}
+
+void printText(const std::vector<Result>& results)
+{
+    std::cout << std::left << std::setw(10) << "index" << std::setw(14) << "distribution" << std::setw(13) << "operation"
+        << std::right << std::setw(10) << "count" << std::setw(10) << "mean";
+    for (auto percentile : Percentiles)
+        std::cout << std::setw(10) << getPercentileName(percentile);
+    std::cout << std::setw(10) << "max" << " (ns)\n";
+    for (const auto& result : results)
+    {
+        const auto& histogram = result.histogram;
+        std::cout << std::left << std::setw(10) << result.index << std::setw(14) << result.distribution
+            << std::setw(13) << result.operation << std::right << std::setw(10) << histogram.getCount()
+            << std::setw(10) << static_cast<std::uint64_t>(histogram.getMean());
+        for (auto percentile : Percentiles)
+            std::cout << std::setw(10) << histogram.getPercentile(percentile);
+        std::cout << std::setw(10) << histogram.getMax() << '\n';
+    }
+}
+
+void printJson(const std::vector<Result>& results, std::size_t n)
+{
+    std::cout << "{\n  \"n\": " << n << ",\n  \"unit\": \"ns\",\n  \"results\": [\n";
+    for (auto i = std::size_t(0); i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        const auto& histogram = result.histogram;
+        std::cout << "    {\"index\": \"" << result.index << "\", \"distribution\": \"" << result.distribution
+            << "\", \"operation\": \"" << result.operation << "\", \"count\": " << histogram.getCount()
+            << ", \"min\": " << histogram.getMin() << ", \"mean\": " << histogram.getMean();
+        for (auto percentile : Percentiles)
+            std::cout << ", \"" << getPercentileName(percentile) << "\": " << histogram.getPercentile(percentile);
+        std::cout << ", \"max\": " << histogram.getMax() << "}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    std::cout << "  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+    auto n = std::size_t(100000);
+    auto json = false;
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], "--n=", 4) == 0)
+            n = std::stoul(argv[i] + 4);
+        else if (std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--n=<number of values>] [--json]\n";
+            return 1;
+        }
+    }
+    auto clock = Clock();
+    auto results = std::vector<Result>();
+    auto stopwatch = Stopwatch(clock, results);
+    for (auto distribution : workloads::Distributions)
+    {
+        measure<QuadtreeIndex>("quadtree", distribution, n, stopwatch);
+        measure<HybridIndex>("hybrid", distribution, n, stopwatch);
+    }
+    if (json)
+        printJson(results, n);
+    else
+        printText(results);
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "indexes.hpp"
+
+// Memory footprint of the indexes in bytes per stored value, per distribution and size
+//
+// Usage: memory [--max-n=<number of values>] [--json]
+
+using namespace quadtree;
+
+using workloads::Node;
+using workloads::Distribution;
+
+struct Result
+{
+    std::string index;
+    std::string distribution;
+    std::size_t n;
+    MemoryUsage usage;
+    std::size_t allocated; // Bytes allocated during the build, including the reallocations
+};
+
+template <typename Index>
+void measure(const std::string& name, Distribution distribution, std::vector<Node>& nodes, bool hashing,
+    std::vector<Result>& results)
+{
+    auto start = getAllocationCounters();
+    auto index = Index(Box(0.0f, 0.0f, 1.0f, 1.0f));
+    index.setHashingEnabled(hashing);
+    for (auto& node : nodes)
+        index.add(&node);
+    auto allocated = (getAllocationCounters() - start).bytes;
+    results.push_back(Result{name, workloads::getName(distribution), nodes.size(), index.memoryUsage(), allocated});
+}
+
+void measureGrid(Distribution distribution, std::vector<Node>& nodes, std::vector<Result>& results)
+{
+    auto start = getAllocationCounters();
+    auto index = CountingGridIndex(Box(0.0f, 0.0f, 1.0f, 1.0f));
+    for (auto& node : nodes)
+        index.add(&node);
+    auto allocated = (getAllocationCounters() - start).bytes;
+    results.push_back(Result{"grid", workloads::getName(distribution), nodes.size(), index.memoryUsage(), allocated});
+}
+
+double getBytesPerValue(std::size_t bytes, std::size_t n)
+{
+    return static_cast<double>(bytes) / static_cast<double>(n);
+}
+
+void printText(const std::vector<Result>& results)
+{
+    std::cout << std::left << std::setw(10) << "index" << std::setw(14) << "distribution" << std::right
+        << std::setw(10) << "n" << std::setw(10) << "total" << std::setw(10) << "nodes" << std::setw(10) << "values"
+        << std::setw(10) << "slack" << std::setw(10) << "indexes" << std::setw(12) << "allocated" << " (bytes/value)\n";
+    std::cout << std::fixed << std::setprecision(1);
+    for (const auto& result : results)
+    {
+        const auto& usage = result.usage;
+        std::cout << std::left << std::setw(10) << result.index << std::setw(14) << result.distribution << std::right
+            << std::setw(10) << result.n << std::setw(10) << getBytesPerValue(usage.getTotal(), result.n)
+            << std::setw(10) << getBytesPerValue(usage.nodes, result.n)
+            << std::setw(10) << getBytesPerValue(usage.values, result.n)
+            << std::setw(10) << getBytesPerValue(usage.slack, result.n)
+            << std::setw(10) << getBytesPerValue(usage.indexes, result.n)
+            << std::setw(12) << getBytesPerValue(result.allocated, result.n) << '\n';
+    }
+}
+
+void printJson(const std::vector<Result>& results)
+{
+    std::cout << "{\n  \"unit\": \"bytes\",\n  \"results\": [\n";
+    for (auto i = std::size_t(0); i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        const auto& usage = result.usage;
+        std::cout << "    {\"index\": \"" << result.index << "\", \"distribution\": \"" << result.distribution
+            << "\", \"n\": " << result.n << ", \"total\": " << usage.getTotal() << ", \"nodes\": " << usage.nodes
+            << ", \"values\": " << usage.values << ", \"slack\": " << usage.slack << ", \"indexes\": " << usage.indexes
+            << ", \"allocated\": " << result.allocated << ", \"bytesPerValue\": "
+            << getBytesPerValue(usage.getTotal(), result.n) << "}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    std::cout << "  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+    auto maxN = std::size_t(10000000);
+    auto json = false;
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], "--max-n=", 8) == 0)
+            maxN = std::stoul(argv[i] + 8);
+        else if (std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--max-n=<number of values>] [--json]\n";
+            return 1;
+        }
+    }
+    auto results = std::vector<Result>();
+    for (auto distribution : workloads::Distributions)
+    {
+        for (auto n = std::size_t(1000); n <= maxN; n *= 10)
+        {
+            auto nodes = workloads::generateNodes(n, distribution);
+            measure<CountingQuadtreeIndex>("quadtree", distribution, nodes, false, results);
+            measure<CountingQuadtreeIndex>("hashing", distribution, nodes, true, results);
+            measure<CountingHybridIndex>("hybrid", distribution, nodes, false, results);
+            measureGrid(distribution, nodes, results);
+        }
+    }
+    if (json)
+        printJson(results);
+    else
+        printText(results);
+    return 0;
+}
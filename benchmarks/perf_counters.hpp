@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters of the calling thread, read with perf_event_open
+// The counters that can not be opened (no permission, container, virtual machine, other OS) are unavailable
+class PerfCounters
+{
+public:
+    static constexpr std::size_t NbCounters = 5;
+    using Values = std::array<double, NbCounters>;
+
+    PerfCounters()
+    {
+        mFds.fill(-1);
+#ifdef __linux__
+        auto getCacheConfig = [](std::uint64_t cache)
+        {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        auto configs = std::array<std::pair<std::uint32_t, std::uint64_t>, NbCounters>{
+            std::make_pair(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+            std::make_pair(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS),
+            std::make_pair(PERF_TYPE_HW_CACHE, getCacheConfig(PERF_COUNT_HW_CACHE_L1D)),
+            std::make_pair(PERF_TYPE_HW_CACHE, getCacheConfig(PERF_COUNT_HW_CACHE_LL)),
+            std::make_pair(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES)
+        };
+        for (auto i = std::size_t(0); i < NbCounters; ++i)
+        {
+            auto attributes = perf_event_attr();
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = configs[i].first;
+            attributes.config = configs[i].second;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            mFds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (auto fd : mFds)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+#endif
+    }
+
+    static const char* getName(std::size_t i)
+    {
+        static constexpr auto names = std::array<const char*, NbCounters>{
+            "cycles", "instructions", "L1d-misses", "LLC-misses", "branch-misses"};
+        return names[i];
+    }
+
+    bool isAvailable(std::size_t i) const
+    {
+        return mFds[i] >= 0;
+    }
+
+    bool isAnyAvailable() const
+    {
+        for (auto i = std::size_t(0); i < NbCounters; ++i)
+        {
+            if (isAvailable(i))
+                return true;
+        }
+        return false;
+    }
+
+    // Current values, scaled when the counters are multiplexed
+    Values read() const
+    {
+        auto values = Values();
+        values.fill(0.0);
+#ifdef __linux__
+        for (auto i = std::size_t(0); i < NbCounters; ++i)
+        {
+            // Value, time enabled and time running
+            auto data = std::array<std::uint64_t, 3>();
+            if (mFds[i] >= 0 && ::read(mFds[i], data.data(), sizeof(data)) == static_cast<ssize_t>(sizeof(data)) &&
+                data[2] > 0)
+                values[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+        }
+#endif
+        return values;
+    }
+
+private:
+    std::array<int, NbCounters> mFds;
+};
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include "Trace.h"
+#include "histogram.hpp"
+#include "indexes.hpp"
+
+// Replay a trace recorded with TraceRecorder against several configurations of the quadtree
+//
+// Usage: replay <trace> [--config=<name>] [--json]
+//        replay --generate=<trace> [--n=<number of values>] [--distribution=<name>]
+//
+// The removes and updates of values added before the recording started can not be
+// replayed, they are skipped and counted
+
+using namespace quadtree;
+
+using workloads::Node;
+using workloads::Distribution;
+
+template<std::size_t LeafGridResolution, std::size_t Threshold, std::size_t MaxDepth>
+using ConfiguredQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, detail::StdMakeUnique,
+    LeafGridResolution, Threshold, MaxDepth>;
+
+using RecordedQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, detail::StdMakeUnique,
+    0, 16, 8, TraceRecorder<float>>;
+
+// Operation of the trace bound to a replayed value
+struct Operation
+{
+    TraceOperation operation;
+    Node* node;
+    Box<float> box;
+    Box<float> oldBox;
+};
+
+struct Trace
+{
+    Box<float> area; // Area of the recorded quadtree
+    std::vector<Node> nodes;
+    std::vector<Operation> operations;
+    std::size_t nbSkipped = 0;
+};
+
+struct Result
+{
+    std::string configuration;
+    std::string operation;
+    Histogram histogram;
+};
+
+constexpr auto Percentiles = std::array<double, 4>{50.0, 90.0, 99.0, 99.9};
+
+volatile std::size_t sink = 0;
+
+const char* getName(TraceOperation operation)
+{
+    switch (operation)
+    {
+        case TraceOperation::Add:
+            return "add";
+        case TraceOperation::Remove:
+            return "remove";
+        case TraceOperation::Update:
+            return "update";
+        case TraceOperation::Query:
+            return "query";
+        case TraceOperation::FindAllIntersections:
+            return "findAllIntersections";
+        default:
+            return "unknown";
+    }
+}
+
+std::array<float, 4> getKey(const Box<float>& box)
+{
+    return {box.left, box.top, box.width, box.height};
+}
+
+// Bind the values of the trace to nodes, a value is identified by its current box
+bool loadTrace(const std::string& path, Trace& trace)
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    auto reader = TraceReader<float>(file);
+    if (!reader.isValid())
+        return false;
+    trace.area = reader.getArea();
+    auto events = std::vector<TraceEvent<float>>();
+    auto event = TraceEvent<float>();
+    auto nbAdds = std::size_t(0);
+    while (reader.read(event))
+    {
+        events.push_back(event);
+        if (event.operation == TraceOperation::Add)
+            ++nbAdds;
+    }
+    trace.nodes.resize(nbAdds);
+    auto liveNodes = std::map<std::array<float, 4>, std::vector<Node*>>();
+    auto takeNode = [&liveNodes](const Box<float>& box) -> Node*
+    {
+        auto it = liveNodes.find(getKey(box));
+        if (it == liveNodes.end() || it->second.empty())
+            return nullptr;
+        auto node = it->second.back();
+        it->second.pop_back();
+        return node;
+    };
+    auto nextNode = std::size_t(0);
+    for (const auto& e : events)
+    {
+        auto operation = Operation{e.operation, nullptr, e.box, e.oldBox};
+        if (e.operation == TraceOperation::Add)
+        {
+            operation.node = &trace.nodes[nextNode];
+            operation.node->id = nextNode++;
+            liveNodes[getKey(e.box)].push_back(operation.node);
+        }
+        else if (e.operation == TraceOperation::Remove || e.operation == TraceOperation::Update)
+        {
+            operation.node = takeNode(e.operation == TraceOperation::Remove ? e.box : e.oldBox);
+            if (operation.node == nullptr)
+            {
+                ++trace.nbSkipped;
+                continue;
+            }
+            if (e.operation == TraceOperation::Update)
+                liveNodes[getKey(e.box)].push_back(operation.node);
+        }
+        trace.operations.push_back(operation);
+    }
+    return true;
+}
+
+template<typename Index>
+void replay(const std::string& name, Trace& trace, bool hashing, std::vector<Result>& results, const Clock& clock)
+{
+    auto index = Index(trace.area);
+    index.setHashingEnabled(hashing);
+    auto histograms = std::map<TraceOperation, Histogram>();
+    for (const auto& operation : trace.operations)
+    {
+        auto node = operation.node;
+        auto start = std::uint64_t(0);
+        switch (operation.operation)
+        {
+            case TraceOperation::Add:
+                node->box = operation.box;
+                start = clock.now();
+                index.add(node);
+                break;
+            case TraceOperation::Remove:
+                start = clock.now();
+                index.remove(node);
+                break;
+            case TraceOperation::Update:
+                node->box = operation.box;
+                start = clock.now();
+                index.update(node, operation.oldBox);
+                break;
+            case TraceOperation::Query:
+                start = clock.now();
+                sink = sink + index.query(operation.box).size();
+                break;
+            case TraceOperation::FindAllIntersections:
+                start = clock.now();
+                sink = sink + index.findAllIntersections().size();
+                break;
+        }
+        histograms[operation.operation].record(clock.toNanoseconds(clock.now() - start));
+    }
+    auto total = Histogram();
+    for (const auto& histogram : histograms)
+    {
+        results.push_back(Result{name, getName(histogram.first), histogram.second});
+        total.merge(histogram.second);
+    }
+    results.push_back(Result{name, "all", total});
+}
+
+// Configurations replayed by replayAll
+constexpr auto Configurations = std::array<const char*, 7>{"default", "hashing", "threshold-4", "threshold-64",
+    "depth-6", "depth-12", "hybrid-8"};
+
+void replayAll(Trace& trace, const std::string& configuration, std::vector<Result>& results)
+{
+    auto clock = Clock();
+    auto run = [&](const std::string& name, auto f)
+    {
+        if (configuration.empty() || configuration == name)
+            f(name);
+    };
+    run("default", [&](const std::string& name){ replay<ConfiguredQuadtree<0, 16, 8>>(name, trace, false, results, clock); });
+    run("hashing", [&](const std::string& name){ replay<ConfiguredQuadtree<0, 16, 8>>(name, trace, true, results, clock); });
+    run("threshold-4", [&](const std::string& name){ replay<ConfiguredQuadtree<0, 4, 8>>(name, trace, false, results, clock); });
+    run("threshold-64", [&](const std::string& name){ replay<ConfiguredQuadtree<0, 64, 8>>(name, trace, false, results, clock); });
+    run("depth-6", [&](const std::string& name){ replay<ConfiguredQuadtree<0, 16, 6>>(name, trace, false, results, clock); });
+    run("depth-12", [&](const std::string& name){ replay<ConfiguredQuadtree<0, 16, 12>>(name, trace, false, results, clock); });
+    run("hybrid-8", [&](const std::string& name){ replay<ConfiguredQuadtree<8, 16, 8>>(name, trace, false, results, clock); });
+}
+
+// Throughput in operations per second
+double getThroughput(const Histogram& histogram)
+{
+    auto duration = histogram.getMean() * static_cast<double>(histogram.getCount());
+    return duration > 0.0 ? 1e9 * static_cast<double>(histogram.getCount()) / duration : 0.0;
+}
+
+void printText(const std::vector<Result>& results, const Trace& trace)
+{
+    std::cout << trace.operations.size() << " operations, " << trace.nbSkipped << " skipped\n";
+    std::cout << std::left << std::setw(14) << "configuration" << std::setw(22) << "operation" << std::right
+        << std::setw(10) << "count" << std::setw(14) << "ops/s" << std::setw(10) << "mean";
+    for (auto percentile : Percentiles)
+        std::cout << std::setw(10) << getPercentileName(percentile);
+    std::cout << std::setw(12) << "max" << " (ns)\n";
+    for (const auto& result : results)
+    {
+        const auto& histogram = result.histogram;
+        std::cout << std::left << std::setw(14) << result.configuration << std::setw(22) << result.operation
+            << std::right << std::setw(10) << histogram.getCount()
+            << std::setw(14) << static_cast<std::uint64_t>(getThroughput(histogram))
+            << std::setw(10) << static_cast<std::uint64_t>(histogram.getMean());
+        for (auto percentile : Percentiles)
+            std::cout << std::setw(10) << histogram.getPercentile(percentile);
+        std::cout << std::setw(12) << histogram.getMax() << '\n';
+    }
+}
+
+void printJson(const std::vector<Result>& results, const Trace& trace)
+{
+    std::cout << "{\n  \"operations\": " << trace.operations.size() << ",\n  \"skipped\": " << trace.nbSkipped
+        << ",\n  \"unit\": \"ns\",\n  \"results\": [\n";
+    for (auto i = std::size_t(0); i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        const auto& histogram = result.histogram;
+        std::cout << "    {\"configuration\": \"" << result.configuration << "\", \"operation\": \""
+            << result.operation << "\", \"count\": " << histogram.getCount() << ", \"throughput\": "
+            << getThroughput(histogram) << ", \"mean\": " << histogram.getMean();
+        for (auto percentile : Percentiles)
+            std::cout << ", \"" << getPercentileName(percentile) << "\": " << histogram.getPercentile(percentile);
+        std::cout << ", \"max\": " << histogram.getMax() << "}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    std::cout << "  ]\n}\n";
+}
+
+// Record a synthetic trace: build, query, move during a few ticks, find all intersections and remove half
+void generateTrace(const std::string& path, std::size_t n, Distribution distribution)
+{
+    auto file = std::ofstream(path, std::ios::binary);
+    auto nodes = workloads::generateNodes(n, distribution);
+    auto quadtree = RecordedQuadtree(Box(0.0f, 0.0f, 1.0f, 1.0f));
+    quadtree.getRecorder().setStream(&file, quadtree.area());
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (const auto& node : nodes)
+        quadtree.query(node.box);
+    auto generator = std::default_random_engine();
+    auto displacementDistribution = std::uniform_real_distribution<float>(-0.001f, 0.001f);
+    for (auto tick = 0; tick < 4; ++tick)
+    {
+        for (auto& node : nodes)
+        {
+            auto oldBox = node.box;
+            moveNode(node, generator, displacementDistribution);
+            quadtree.update(&node, oldBox);
+        }
+    }
+    quadtree.findAllIntersections();
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+        quadtree.remove(&nodes[i]);
+}
+
+int main(int argc, char** argv)
+{
+    auto path = std::string();
+    auto generatedPath = std::string();
+    auto configuration = std::string();
+    auto n = std::size_t(100000);
+    auto distribution = Distribution::Uniform;
+    auto json = false;
+    auto usage = [argv]()
+    {
+        std::cerr << "Usage: " << argv[0] << " <trace> [--config=<name>] [--json]\n"
+            << "       " << argv[0] << " --generate=<trace> [--n=<number of values>] [--distribution=<name>]\n"
+            << "Configurations:";
+        for (const auto& name : Configurations)
+            std::cerr << ' ' << name;
+        std::cerr << '\n';
+        return 1;
+    };
+    for (auto i = 1; i < argc; ++i)
+    {
+        auto argument = std::string(argv[i]);
+        if (argument.compare(0, 11, "--generate=") == 0)
+            generatedPath = argument.substr(11);
+        else if (argument.compare(0, 9, "--config=") == 0)
+        {
+            configuration = argument.substr(9);
+            if (std::find(std::begin(Configurations), std::end(Configurations), configuration) == std::end(Configurations))
+                return usage();
+        }
+        else if (argument.compare(0, 4, "--n=") == 0)
+            n = std::stoul(argument.substr(4));
+        else if (argument.compare(0, 15, "--distribution=") == 0)
+        {
+            auto name = argument.substr(15);
+            auto it = std::find_if(std::begin(workloads::Distributions), std::end(workloads::Distributions),
+                [&name](Distribution d){ return name == workloads::getName(d); });
+            if (it == std::end(workloads::Distributions))
+                return usage();
+            distribution = *it;
+        }
+        else if (argument == "--json")
+            json = true;
+        else if (argument.compare(0, 2, "--") != 0 && path.empty())
+            path = argument;
+        else
+            return usage();
+    }
+    if (!generatedPath.empty())
+    {
+        generateTrace(generatedPath, n, distribution);
+        return 0;
+    }
+    if (path.empty())
+        return usage();
+    auto trace = Trace();
+    if (!loadTrace(path, trace))
+    {
+        std::cerr << "Invalid trace: " << path << '\n';
+        return 1;
+    }
+    auto results = std::vector<Result>();
+    replayAll(trace, configuration, results);
+    if (json)
+        printJson(results, trace);
+    else
+        printText(results, trace);
+    return 0;
+}
@@ -0,0 +1,319 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include "Executor.h"
+#include "histogram.hpp"
+#include "indexes.hpp"
+
+// Scaling of the operations that can run on several threads, from 1 thread up to hardware_concurrency,
+// the parallel operations of the quadtree run on the executors of Executor.h
+//
+// Usage: scaling [--n=<number of values>] [--json]
+
+using namespace quadtree;
+
+using workloads::Node;
+
+struct ScalingResult
+{
+    std::string operation;
+    std::size_t nbThreads;
+    double duration; // In seconds
+    double speedup;
+    double efficiency;
+};
+
+struct ContentionResult
+{
+    std::size_t nbReaders;
+    bool writer;
+    Histogram readerLatencies;
+    double readerThroughput; // Queries per second
+    double writerThroughput; // Updates per second
+};
+
+volatile std::size_t sink = 0;
+
+std::vector<std::size_t> getThreadCounts()
+{
+    auto maxThreads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    auto threadCounts = std::vector<std::size_t>();
+    for (auto nbThreads = std::size_t(1); nbThreads < maxThreads; nbThreads *= 2)
+        threadCounts.push_back(nbThreads);
+    threadCounts.push_back(maxThreads);
+    return threadCounts;
+}
+
+// Run f(begin, end) on nbThreads threads, each on a contiguous share of [0, n)
+template<typename F>
+void runOnThreads(std::size_t nbThreads, std::size_t n, F&& f)
+{
+    auto threads = std::vector<std::thread>();
+    for (auto i = std::size_t(0); i < nbThreads; ++i)
+        threads.emplace_back([&f, i, n, nbThreads](){ f(i * n / nbThreads, (i + 1) * n / nbThreads); });
+    for (auto& thread : threads)
+        thread.join();
+}
+
+// Best of a few runs, in seconds
+double measure(const std::function<void()>& f)
+{
+    auto best = std::numeric_limits<double>::max();
+    for (auto i = 0; i < 5; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+void measureScaling(const std::string& operation, const std::function<void(std::size_t)>& f,
+    std::vector<ScalingResult>& results)
+{
+    auto reference = 0.0;
+    for (auto nbThreads : getThreadCounts())
+    {
+        auto duration = measure([&f, nbThreads](){ f(nbThreads); });
+        if (nbThreads == 1)
+            reference = duration;
+        auto speedup = reference / duration;
+        results.push_back(ScalingResult{operation, nbThreads, duration, speedup, speedup / static_cast<double>(nbThreads)});
+    }
+}
+
+// Concurrent queries, the values are only read
+void measureQueries(std::vector<Node>& nodes, std::vector<ScalingResult>& results)
+{
+    auto index = QuadtreeIndex(Box(0.0f, 0.0f, 1.0f, 1.0f));
+    for (auto& node : nodes)
+        index.add(&node);
+    measureScaling("query", [&](std::size_t nbThreads)
+    {
+        runOnThreads(nbThreads, nodes.size(), [&](std::size_t begin, std::size_t end)
+        {
+            auto nbIntersections = std::size_t(0);
+            for (auto i = begin; i < end; ++i)
+                nbIntersections += index.query(nodes[i].box).size();
+            sink = sink + nbIntersections;
+        });
+    }, results);
+    auto generator = std::default_random_engine();
+    auto pointDistribution = std::uniform_real_distribution<float>(0.0f, 1.0f);
+    auto points = std::vector<Box<float>>(nodes.size());
+    for (auto& point : points)
+        point = Box(pointDistribution(generator), pointDistribution(generator), 0.0f, 0.0f);
+    measureScaling("findClosest", [&](std::size_t nbThreads)
+    {
+        runOnThreads(nbThreads, points.size(), [&](std::size_t begin, std::size_t end)
+        {
+            auto nbFound = std::size_t(0);
+            for (auto i = begin; i < end; ++i)
+                nbFound += index.findClosest(points[i]) != nullptr ? std::size_t(1) : std::size_t(0);
+            sink = sink + nbFound;
+        });
+    }, results);
+}
+
+// Parallel operations of the quadtree, the threads of the pools are started out of the measures
+void measureParallelOperations(std::vector<Node>& nodes, std::vector<ScalingResult>& results)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto values = std::vector<Node*>();
+    auto boxes = std::vector<Box<float>>();
+    for (auto& node : nodes)
+    {
+        values.push_back(&node);
+        boxes.push_back(node.box);
+    }
+    auto pools = std::map<std::size_t, std::unique_ptr<ThreadPool>>();
+    for (auto nbThreads : getThreadCounts())
+        pools[nbThreads] = std::make_unique<ThreadPool>(nbThreads);
+    measureScaling("parallel build", [&](std::size_t nbThreads)
+    {
+        auto index = QuadtreeIndex(box);
+        index.build(values, *pools[nbThreads]);
+        sink = sink + index.query(box).size();
+    }, results);
+    auto index = QuadtreeIndex(box);
+    for (auto& node : nodes)
+        index.add(&node);
+    measureScaling("batch query", [&](std::size_t nbThreads)
+    {
+        sink = sink + index.query(boxes, *pools[nbThreads]).size();
+    }, results);
+    measureScaling("findAllIntersections", [&](std::size_t nbThreads)
+    {
+        sink = sink + index.findAllIntersections(*pools[nbThreads]).size();
+    }, results);
+    // The threads are started by each call
+    measureScaling("intersections (threads)", [&](std::size_t nbThreads)
+    {
+        auto executor = ThreadExecutor(nbThreads);
+        sink = sink + index.findAllIntersections(executor).size();
+    }, results);
+}
+
+// Readers query while a writer moves the values, they share the index through a reader-writer lock
+ContentionResult measureContention(std::vector<Node>& nodes, std::size_t nbReaders, bool writer)
+{
+    auto index = QuadtreeIndex(Box(0.0f, 0.0f, 1.0f, 1.0f));
+    for (auto& node : nodes)
+        index.add(&node);
+    auto mutex = std::shared_mutex();
+    auto stop = std::atomic<bool>(false);
+    auto clock = Clock();
+    auto latencies = std::vector<Histogram>(nbReaders);
+    auto nbUpdates = std::size_t(0);
+    auto threads = std::vector<std::thread>();
+    for (auto i = std::size_t(0); i < nbReaders; ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            auto generator = std::default_random_engine(i + 1);
+            auto nodeDistribution = std::uniform_int_distribution<std::size_t>(0, nodes.size() - 1);
+            auto nbIntersections = std::size_t(0);
+            // Local to not share cache lines with the other readers
+            auto localLatencies = Histogram();
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                auto& node = nodes[nodeDistribution(generator)];
+                auto start = clock.now();
+                {
+                    auto lock = std::shared_lock<std::shared_mutex>(mutex);
+                    nbIntersections += index.query(node.box).size();
+                }
+                localLatencies.record(clock.toNanoseconds(clock.now() - start));
+            }
+            latencies[i] = std::move(localLatencies);
+            sink = sink + nbIntersections;
+        });
+    }
+    if (writer)
+    {
+        threads.emplace_back([&]()
+        {
+            auto generator = std::default_random_engine();
+            auto displacementDistribution = std::uniform_real_distribution<float>(-0.001f, 0.001f);
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                auto& node = nodes[nbUpdates % nodes.size()];
+                {
+                    auto lock = std::unique_lock<std::shared_mutex>(mutex);
+                    auto oldBox = node.box;
+                    moveNode(node, generator, displacementDistribution);
+                    index.update(&node, oldBox);
+                }
+                ++nbUpdates;
+            }
+        });
+    }
+    auto duration = 0.5;
+    std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+    stop = true;
+    for (auto& thread : threads)
+        thread.join();
+    auto result = ContentionResult{nbReaders, writer, Histogram(), 0.0, static_cast<double>(nbUpdates) / duration};
+    for (auto i = std::size_t(0); i < nbReaders; ++i)
+    {
+        result.readerLatencies.merge(latencies[i]);
+        result.readerThroughput += static_cast<double>(latencies[i].getCount()) / duration;
+    }
+    return result;
+}
+
+void printText(const std::vector<ScalingResult>& scalingResults, const std::vector<ContentionResult>& contentionResults)
+{
+    std::cout << std::left << std::setw(24) << "operation" << std::right << std::setw(8) << "threads"
+        << std::setw(14) << "time (ms)" << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << '\n';
+    for (const auto& result : scalingResults)
+    {
+        std::cout << std::left << std::setw(24) << result.operation << std::right << std::setw(8) << result.nbThreads
+            << std::fixed << std::setprecision(3) << std::setw(14) << result.duration * 1000.0
+            << std::setprecision(2) << std::setw(10) << result.speedup << std::setw(12) << result.efficiency << '\n';
+    }
+    std::cout << '\n' << std::setw(8) << "readers" << std::setw(8) << "writer" << std::setw(14) << "queries/s"
+        << std::setw(14) << "updates/s";
+    for (auto percentile : {50.0, 99.0, 99.9})
+        std::cout << std::setw(10) << getPercentileName(percentile);
+    std::cout << std::setw(12) << "max" << " (ns)\n";
+    for (const auto& result : contentionResults)
+    {
+        std::cout << std::setprecision(0) << std::setw(8) << result.nbReaders << std::setw(8) << (result.writer ? "yes" : "no")
+            << std::setw(14) << result.readerThroughput << std::setw(14) << result.writerThroughput;
+        for (auto percentile : {50.0, 99.0, 99.9})
+            std::cout << std::setw(10) << result.readerLatencies.getPercentile(percentile);
+        std::cout << std::setw(12) << result.readerLatencies.getMax() << '\n';
+    }
+}
+
+void printJson(const std::vector<ScalingResult>& scalingResults, const std::vector<ContentionResult>& contentionResults,
+    std::size_t n)
+{
+    std::cout << "{\n  \"n\": " << n << ",\n  \"scaling\": [\n";
+    for (auto i = std::size_t(0); i < scalingResults.size(); ++i)
+    {
+        const auto& result = scalingResults[i];
+        std::cout << "    {\"operation\": \"" << result.operation << "\", \"threads\": " << result.nbThreads
+            << ", \"seconds\": " << result.duration << ", \"speedup\": " << result.speedup << ", \"efficiency\": "
+            << result.efficiency << "}" << (i + 1 < scalingResults.size() ? "," : "") << '\n';
+    }
+    std::cout << "  ],\n  \"contention\": [\n";
+    for (auto i = std::size_t(0); i < contentionResults.size(); ++i)
+    {
+        const auto& result = contentionResults[i];
+        std::cout << "    {\"readers\": " << result.nbReaders << ", \"writer\": " << (result.writer ? "true" : "false")
+            << ", \"queriesPerSecond\": " << result.readerThroughput << ", \"updatesPerSecond\": "
+            << result.writerThroughput;
+        for (auto percentile : {50.0, 99.0, 99.9})
+            std::cout << ", \"" << getPercentileName(percentile) << "\": " << result.readerLatencies.getPercentile(percentile);
+        std::cout << ", \"max\": " << result.readerLatencies.getMax() << "}"
+            << (i + 1 < contentionResults.size() ? "," : "") << '\n';
+    }
+    std::cout << "  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+    auto n = std::size_t(100000);
+    auto json = false;
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], "--n=", 4) == 0)
+            n = std::stoul(argv[i] + 4);
+        else if (std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--n=<number of values>] [--json]\n";
+            return 1;
+        }
+    }
+    auto nodes = workloads::generateRandomNodes(n);
+    auto scalingResults = std::vector<ScalingResult>();
+    measureQueries(nodes, scalingResults);
+    measureParallelOperations(nodes, scalingResults);
+    auto contentionResults = std::vector<ContentionResult>();
+    for (auto nbReaders : getThreadCounts())
+    {
+        for (auto writer : {false, true})
+        {
+            nodes = workloads::generateRandomNodes(n);
+            contentionResults.push_back(measureContention(nodes, nbReaders, writer));
+        }
+    }
+    if (json)
+        printJson(scalingResults, contentionResults, n);
+    else
+        printText(scalingResults, contentionResults);
+    return 0;
+}
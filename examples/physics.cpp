@@ -1,108 +1,252 @@
-#include <cassert>
+#include <algorithm>
 #include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <random>
+#include <string>
 #include "Quadtree.h"
+#include "Workloads.h"
+
+// Frame loop of a physics simulation: the bodies move and bounce in the area, the quadtree
+// is updated every frame and used as the broadphase, sampled frames are checked against brute force
+//
+// Usage: physics [--bodies=<n>] [--frames=<n>] [--check-every=<n>] [--distribution=<name>] [--hashing] [--json]
 
 using namespace quadtree;
 
-struct Node
+using workloads::Node;
+
+using Pair = std::pair<Node*, Node*>;
+
+struct Settings
 {
-    Box<float> box;
-    std::size_t id;
+    std::size_t nbBodies = 10000;
+    std::size_t nbFrames = 600;
+    std::size_t checkEvery = 60; // 0 to never check
+    workloads::Distribution distribution = workloads::Distribution::Uniform;
+    bool hashing = false;
+    bool json = false;
 };
 
-std::vector<Node> generateRandomNodes(std::size_t n)
+// Durations of the phases of each frame in microseconds
+struct FrameTimes
 {
-    auto generator = std::default_random_engine();
-    auto originDistribution = std::uniform_real_distribution<float>(0.0f, 1.0f);
-    auto sizeDistribution = std::uniform_real_distribution<float>(0.0f, 0.01f);
-    auto nodes = std::vector<Node>(n);
-    for (auto i = std::size_t(0); i < n; ++i)
+    std::vector<double> integration;
+    std::vector<double> broadphase;
+    std::vector<double> response;
+    std::vector<double> total;
+};
+
+std::vector<Pair> computeIntersections(std::vector<Node>& nodes)
+{
+    auto intersections = std::vector<Pair>();
+    for (auto i = std::size_t(0); i < nodes.size(); ++i)
     {
-        nodes[i].box.left = originDistribution(generator);
-        nodes[i].box.top = originDistribution(generator);
-        nodes[i].box.width = std::min(1.0f - nodes[i].box.left, sizeDistribution(generator));
-        nodes[i].box.height = std::min(1.0f - nodes[i].box.top, sizeDistribution(generator));
-        nodes[i].id = i;
+        for (auto j = std::size_t(0); j < i; ++j)
+        {
+            if (nodes[i].box.intersects(nodes[j].box))
+                intersections.emplace_back(&nodes[i], &nodes[j]);
+        }
     }
-    return nodes;
+    return intersections;
 }
 
-std::vector<std::pair<Node*, Node*>> computeIntersections(std::vector<Node>& nodes, const std::vector<bool>& removed)
+bool checkIntersections(std::vector<Pair> intersections1, std::vector<Pair> intersections2)
 {
-    auto intersections = std::vector<std::pair<Node*, Node*>>();
-    for (auto i = std::size_t(0); i < nodes.size(); ++i)
+    if (intersections1.size() != intersections2.size())
+        return false;
+    for (auto intersections : {&intersections1, &intersections2})
     {
-        if (removed.size() == 0 || !removed[i])
+        for (auto& intersection : *intersections)
         {
-            for (auto j = std::size_t(0); j < i; ++j)
+            if (intersection.first > intersection.second)
+                std::swap(intersection.first, intersection.second);
+        }
+        std::sort(std::begin(*intersections), std::end(*intersections));
+    }
+    return intersections1 == intersections2;
+}
+
+// Move the body during dt and bounce on the borders of the unit area
+void integrate(Node& node, Vector2<float>& velocity, float dt)
+{
+    auto& box = node.box;
+    box.left += velocity.x * dt;
+    box.top += velocity.y * dt;
+    if (box.left < 0.0f || box.getRight() > 1.0f)
+    {
+        velocity.x = -velocity.x;
+        box.left = std::min(std::max(box.left, 0.0f), 1.0f - box.width);
+    }
+    if (box.top < 0.0f || box.getBottom() > 1.0f)
+    {
+        velocity.y = -velocity.y;
+        box.top = std::min(std::max(box.top, 0.0f), 1.0f - box.height);
+    }
+}
+
+double getMicroseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// Nearest-rank percentile, 0 is the minimum and 100 the maximum
+double getPercentile(std::vector<double> values, double percentile)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(std::begin(values), std::end(values));
+    auto rank = static_cast<std::size_t>(percentile / 100.0 * static_cast<double>(values.size() - 1) + 0.5);
+    return values[rank];
+}
+
+void printResults(const Settings& settings, const FrameTimes& frameTimes, double contactsPerFrame,
+    std::size_t nbCheckedFrames)
+{
+    auto phases = {std::make_pair("integration", &frameTimes.integration),
+        std::make_pair("broadphase", &frameTimes.broadphase), std::make_pair("response", &frameTimes.response),
+        std::make_pair("frame", &frameTimes.total)};
+    auto percentiles = {0.0, 50.0, 90.0, 99.0, 100.0};
+    auto getPercentileName = [](double percentile)
+    {
+        return percentile == 0.0 ? std::string("min") : percentile == 100.0 ? std::string("max") :
+            "p" + std::to_string(static_cast<int>(percentile));
+    };
+    if (settings.json)
+    {
+        std::cout << "{\n  \"bodies\": " << settings.nbBodies << ",\n  \"frames\": " << settings.nbFrames
+            << ",\n  \"distribution\": \"" << workloads::getName(settings.distribution) << "\",\n  \"hashing\": "
+            << (settings.hashing ? "true" : "false") << ",\n  \"contactsPerFrame\": " << contactsPerFrame
+            << ",\n  \"checkedFrames\": " << nbCheckedFrames << ",\n  \"unit\": \"us\",\n  \"phases\": {\n";
+        auto first = true;
+        for (const auto& phase : phases)
+        {
+            std::cout << (first ? "" : ",\n") << "    \"" << phase.first << "\": {";
+            auto firstPercentile = true;
+            for (auto percentile : percentiles)
             {
-                if (removed.size() == 0 || !removed[j])
-                {
-                    if (nodes[i].box.intersects(nodes[j].box))
-                        intersections.emplace_back(&nodes[i], &nodes[j]);
-                }
+                std::cout << (firstPercentile ? "" : ", ") << '"' << getPercentileName(percentile) << "\": "
+                    << getPercentile(*phase.second, percentile);
+                firstPercentile = false;
             }
+            std::cout << "}";
+            first = false;
         }
+        std::cout << "\n  }\n}\n";
+        return;
+    }
+    std::cout << settings.nbBodies << " bodies, " << settings.nbFrames << " frames, "
+        << workloads::getName(settings.distribution) << (settings.hashing ? ", hashing" : "") << '\n'
+        << contactsPerFrame << " contacts per frame, " << nbCheckedFrames << " frames checked against brute force\n";
+    std::cout << std::left << std::setw(14) << "phase" << std::right;
+    for (auto percentile : percentiles)
+        std::cout << std::setw(10) << getPercentileName(percentile);
+    std::cout << " (us)\n" << std::fixed << std::setprecision(1);
+    for (const auto& phase : phases)
+    {
+        std::cout << std::left << std::setw(14) << phase.first << std::right;
+        for (auto percentile : percentiles)
+            std::cout << std::setw(10) << getPercentile(*phase.second, percentile);
+        std::cout << '\n';
     }
-    return intersections;
 }
 
-void checkIntersections(std::vector<Node*> nodes1, std::vector<Node*> nodes2)
+bool parseArguments(int argc, char** argv, Settings& settings)
 {
-    assert(nodes1.size() == nodes2.size());
-    std::sort(std::begin(nodes1), std::end(nodes1));
-    std::sort(std::begin(nodes2), std::end(nodes2));
-    for (auto i = std::size_t(0); i < nodes1.size(); ++i)
-        assert(nodes1[i] == nodes2[i]);
+    for (auto i = 1; i < argc; ++i)
+    {
+        auto argument = std::string(argv[i]);
+        auto getValue = [&argument](){ return std::stoul(argument.substr(argument.find('=') + 1)); };
+        if (argument.compare(0, 9, "--bodies=") == 0)
+            settings.nbBodies = getValue();
+        else if (argument.compare(0, 9, "--frames=") == 0)
+            settings.nbFrames = getValue();
+        else if (argument.compare(0, 14, "--check-every=") == 0)
+            settings.checkEvery = getValue();
+        else if (argument.compare(0, 15, "--distribution=") == 0)
+        {
+            auto name = argument.substr(15);
+            auto it = std::find_if(std::begin(workloads::Distributions), std::end(workloads::Distributions),
+                [&name](workloads::Distribution d){ return name == workloads::getName(d); });
+            if (it == std::end(workloads::Distributions))
+                return false;
+            settings.distribution = *it;
+        }
+        else if (argument == "--hashing")
+            settings.hashing = true;
+        else if (argument == "--json")
+            settings.json = true;
+        else
+            return false;
+    }
+    return true;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    auto n = std::size_t(1000);
+    auto settings = Settings();
+    if (!parseArguments(argc, argv, settings))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--bodies=<n>] [--frames=<n>] [--check-every=<n>]"
+            " [--distribution=<name>] [--hashing] [--json]\n";
+        return 1;
+    }
     auto getBox = [](Node* node)
     {
         return node->box;
     };
     auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
-    auto nodes = generateRandomNodes(n);
-    // Add nodes to quadtree
+    auto nodes = workloads::generateNodes(settings.nbBodies, settings.distribution);
+    auto generator = std::default_random_engine();
+    auto velocityDistribution = std::uniform_real_distribution<float>(-0.2f, 0.2f);
+    auto velocities = std::vector<Vector2<float>>(nodes.size());
+    for (auto& velocity : velocities)
+        velocity = Vector2<float>(velocityDistribution(generator), velocityDistribution(generator));
     auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
-    auto start1 = std::chrono::steady_clock::now();
+    quadtree.setHashingEnabled(settings.hashing);
     for (auto& node : nodes)
         quadtree.add(&node);
-    // Randomly remove some nodes
-    auto generator = std::default_random_engine();
-    auto deathDistribution = std::uniform_int_distribution<int>(0, 1);
-    auto removed = std::vector<bool>(nodes.size(), false);
-    std::generate(std::begin(removed), std::end(removed),
-        [&generator, &deathDistribution](){ return deathDistribution(generator); });
-    for (auto& node : nodes)
+    auto dt = 1.0f / 60.0f;
+    auto frameTimes = FrameTimes();
+    auto nbContacts = std::size_t(0);
+    auto nbCheckedFrames = std::size_t(0);
+    for (auto frame = std::size_t(0); frame < settings.nbFrames; ++frame)
     {
-        if (removed[node.id])
-            quadtree.remove(&node);
-    }
-    // Quadtree
-    auto intersections1 = std::vector<std::vector<Node*>>(nodes.size());
-    auto start2 = std::chrono::steady_clock::now();
-    for (const auto& node : nodes)
-    {
-        if (!removed[node.id])
-            intersections1[node.id] = quadtree.query(node.box);
+        auto start = std::chrono::steady_clock::now();
+        // Integrate and update the quadtree
+        for (auto& node : nodes)
+        {
+            auto oldBox = node.box;
+            integrate(node, velocities[node.id], dt);
+            quadtree.update(&node, oldBox);
+        }
+        auto integrated = std::chrono::steady_clock::now();
+        // Broadphase
+        auto contacts = quadtree.findAllIntersections();
+        auto detected = std::chrono::steady_clock::now();
+        // Response, the bodies have the same mass and exchange their velocities
+        for (const auto& contact : contacts)
+            std::swap(velocities[contact.first->id], velocities[contact.second->id]);
+        auto end = std::chrono::steady_clock::now();
+        frameTimes.integration.push_back(getMicroseconds(start, integrated));
+        frameTimes.broadphase.push_back(getMicroseconds(integrated, detected));
+        frameTimes.response.push_back(getMicroseconds(detected, end));
+        frameTimes.total.push_back(getMicroseconds(start, end));
+        nbContacts += contacts.size();
+        // Check the sampled frames out of the timed section, asserts are disabled in release
+        if (settings.checkEvery > 0 && frame % settings.checkEvery == 0)
+        {
+            if (!checkIntersections(std::vector<Pair>(std::begin(contacts), std::end(contacts)),
+                computeIntersections(nodes)))
+            {
+                std::cerr << "Frame " << frame << ": the broadphase differs from brute force\n";
+                return 1;
+            }
+            ++nbCheckedFrames;
+        }
     }
-    auto duration2 = std::chrono::steady_clock::now() - start2;
-    auto duration1 = std::chrono::steady_clock::now() - start1;
-    std::cout << "quadtree: " << std::chrono::duration_cast<std::chrono::microseconds>(duration2).count() << "us" << '\n';
-    std::cout << "quadtree with creation: " << std::chrono::duration_cast<std::chrono::microseconds>(duration1).count() << "us" << '\n';
-    // Brute force
-    auto intersections2 = computeIntersections(nodes, removed);
-    // Check
-    //checkIntersections(intersections1[node.id], intersections2[node.id]);
-    // Find all intersections
-    auto intersections3 = quadtree.findAllIntersections();
-    std::cout << intersections3.size() << '\n';
-    std::cout << intersections2.size() << '\n';
-
+    auto contactsPerFrame = settings.nbFrames > 0 ?
+        static_cast<double>(nbContacts) / static_cast<double>(settings.nbFrames) : 0.0;
+    printResults(settings, frameTimes, contactsPerFrame, nbCheckedFrames);
     return 0;
 }
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace quadtree
+{
+
+namespace detail
+{
+    // Blocks of objects of type T and the slots freed in them. The pool is referenced by
+    // the policies sharing it and by the objects it holds, it is deleted with the last one.
+    template <typename T>
+    class BlockPool
+    {
+    public:
+        // Blocks of about 16 KiB
+        static constexpr auto BlockSize = sizeof(T) < 16384 ? 16384 / sizeof(T) : std::size_t(1);
+
+        BlockPool() = default;
+        BlockPool(const BlockPool&) = delete;
+        BlockPool& operator=(const BlockPool&) = delete;
+
+        ~BlockPool()
+        {
+            for (auto block : mBlocks)
+                ::operator delete(block);
+        }
+
+        void addReference()
+        {
+            auto lock = std::unique_lock<std::mutex>(mMutex);
+            ++mNbReferences;
+        }
+
+        void removeReference()
+        {
+            auto lock = std::unique_lock<std::mutex>(mMutex);
+            if (--mNbReferences == 0)
+            {
+                lock.unlock();
+                delete this;
+            }
+        }
+
+        // The freed slots are reused first, otherwise the slots are given in order
+        void* allocate()
+        {
+            auto lock = std::unique_lock<std::mutex>(mMutex);
+            if (!mFreeSlots.empty())
+            {
+                auto slot = mFreeSlots.back();
+                mFreeSlots.pop_back();
+                ++mNbReferences;
+                return slot;
+            }
+            if (mBlocks.empty() || mNbUsedSlots == BlockSize)
+            {
+                mBlocks.reserve(mBlocks.size() + 1);
+                mBlocks.push_back(static_cast<T*>(::operator new(BlockSize * sizeof(T))));
+                mNbUsedSlots = 0;
+            }
+            ++mNbReferences;
+            return mBlocks.back() + mNbUsedSlots++;
+        }
+
+        void deallocate(void* slot)
+        {
+            {
+                auto lock = std::unique_lock<std::mutex>(mMutex);
+                mFreeSlots.push_back(slot);
+            }
+            removeReference();
+        }
+
+    private:
+        std::mutex mMutex;
+        std::size_t mNbReferences = 1; // The policy creating the pool
+        std::vector<T*> mBlocks;
+        std::size_t mNbUsedSlots = 0; // In the last block
+        std::vector<void*> mFreeSlots;
+    };
+
+    template <typename T>
+    struct BlockDeleter
+    {
+        BlockPool<T>* pool = nullptr;
+
+        void operator()(T* object) const
+        {
+            object->~T();
+            pool->deallocate(object);
+        }
+    };
+}
+
+// MakeUnique policy that constructs the objects in blocks, so that the objects
+// constructed one after the other are contiguous in memory. The copies of a policy
+// share its blocks and can be called from several threads, a new policy starts new
+// blocks. The blocks are released once the policies and the objects are destroyed,
+// in any order.
+template <typename T>
+class BlockMakeUnique
+{
+public:
+    using Pointer = std::unique_ptr<T, detail::BlockDeleter<T>>;
+
+    BlockMakeUnique() : mPool(new detail::BlockPool<T>())
+    {
+
+    }
+
+    BlockMakeUnique(const BlockMakeUnique& other) : mPool(other.mPool)
+    {
+        mPool->addReference();
+    }
+
+    BlockMakeUnique(BlockMakeUnique&& other) noexcept : mPool(other.mPool)
+    {
+        other.mPool = nullptr;
+    }
+
+    ~BlockMakeUnique()
+    {
+        if (mPool != nullptr)
+            mPool->removeReference();
+    }
+
+    BlockMakeUnique& operator=(BlockMakeUnique other) noexcept
+    {
+        std::swap(mPool, other.mPool);
+        return *this;
+    }
+
+    template <typename... Args>
+    Pointer operator()(Args&&... args)
+    {
+        // T is incomplete where the quadtree names the type of the pointers
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported");
+        auto slot = mPool->allocate();
+        try
+        {
+            auto object = new (slot) T(std::forward<Args>(args)...);
+            return Pointer(object, detail::BlockDeleter<T>{mPool});
+        }
+        catch (...)
+        {
+            mPool->deallocate(slot);
+            throw;
+        }
+    }
+
+private:
+    detail::BlockPool<T>* mPool;
+};
+
+}
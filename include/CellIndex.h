@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "Box.h"
+#include "MemoryUsage.h"
+
+namespace quadtree
+{
+
+namespace detail
+{
+
+// Uniform subdivision of a box in cells, each cell storing the boxes and the
+// indices of the entries that overlap it. An entry spanning several cells is
+// stored in all of them, the queries make sure to report it only once.
+template<
+    typename Float,
+    template <typename> class Allocator = std::allocator
+>
+class CellIndex
+{
+public:
+    template <typename U>
+    using vector_type = std::vector< U, Allocator<U> >;
+
+    static constexpr auto npos = std::numeric_limits<std::size_t>::max();
+
+    struct Entry
+    {
+        Box<Float> box;
+        std::size_t index;
+    };
+
+    CellIndex(const Box<Float>& box, std::size_t nbColumns, std::size_t nbRows) :
+        mBox(box), mNbColumns(std::max<std::size_t>(nbColumns, 1)), mNbRows(std::max<std::size_t>(nbRows, 1)),
+        mCellWidth(box.width / static_cast<Float>(mNbColumns)),
+        mCellHeight(box.height / static_cast<Float>(mNbRows)),
+        mCells(mNbColumns * mNbRows)
+    {
+
+    }
+
+    const Box<Float>& area() const
+    {
+        return mBox;
+    }
+
+    std::size_t getNbColumns() const
+    {
+        return mNbColumns;
+    }
+
+    std::size_t getNbRows() const
+    {
+        return mNbRows;
+    }
+
+    const vector_type<vector_type<Entry>>& getCells() const
+    {
+        return mCells;
+    }
+
+    // The cells and their entries are counted as indexes
+    MemoryUsage memoryUsage() const
+    {
+        auto usage = MemoryUsage();
+        usage.indexes = mCells.size() * sizeof(vector_type<Entry>);
+        usage.slack = (mCells.capacity() - mCells.size()) * sizeof(vector_type<Entry>);
+        for (const auto& cell : mCells)
+        {
+            usage.indexes += cell.size() * sizeof(Entry);
+            usage.slack += (cell.capacity() - cell.size()) * sizeof(Entry);
+        }
+        return usage;
+    }
+
+    Box<Float> getCellBox(std::size_t column, std::size_t row) const
+    {
+        return Box<Float>(mBox.left + static_cast<Float>(column) * mCellWidth,
+            mBox.top + static_cast<Float>(row) * mCellHeight, mCellWidth, mCellHeight);
+    }
+
+    void insert(std::size_t index, const Box<Float>& box)
+    {
+        auto range = getCellRange(box);
+        for (auto y = range.top; y <= range.bottom; ++y)
+        {
+            for (auto x = range.left; x <= range.right; ++x)
+                getCell(x, y).push_back(Entry{box, index});
+        }
+    }
+
+    void erase(std::size_t index, const Box<Float>& box)
+    {
+        auto range = getCellRange(box);
+        for (auto y = range.top; y <= range.bottom; ++y)
+        {
+            for (auto x = range.left; x <= range.right; ++x)
+            {
+                auto& cell = getCell(x, y);
+                auto it = std::find_if(std::begin(cell), std::end(cell),
+                    [index](const Entry& entry){ return entry.index == index; });
+                assert(it != std::end(cell) && "Trying to erase an entry that is not present in the cell");
+                // Swap with the last element and pop back
+                *it = std::move(cell.back());
+                cell.pop_back();
+            }
+        }
+    }
+
+    // Update the index of an entry, used when the values are moved in the storage
+    void reindex(std::size_t oldIndex, std::size_t newIndex, const Box<Float>& box)
+    {
+        auto range = getCellRange(box);
+        for (auto y = range.top; y <= range.bottom; ++y)
+        {
+            for (auto x = range.left; x <= range.right; ++x)
+            {
+                for (auto& entry : getCell(x, y))
+                {
+                    if (entry.index == oldIndex)
+                    {
+                        entry.index = newIndex;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    void shrinkToFit()
+    {
+        for (auto& cell : mCells)
+            cell.shrink_to_fit();
+    }
+
+    void clear()
+    {
+        for (auto& cell : mCells)
+            cell.clear();
+    }
+
+    // Return the index of the first entry with this box for which matches returns true
+    template <typename F>
+    std::size_t find(const Box<Float>& box, F&& matches) const
+    {
+        // All the cells of the range contain the entry, the first one is enough
+        auto range = getCellRange(box);
+        for (const auto& entry : getCell(range.left, range.top))
+        {
+            if (matches(entry.index))
+                return entry.index;
+        }
+        return npos;
+    }
+
+    // Call f(index) once for each entry intersecting box
+    template <typename F>
+    void query(const Box<Float>& box, F&& f) const
+    {
+        auto range = getCellRange(box);
+        for (auto y = range.top; y <= range.bottom; ++y)
+        {
+            for (auto x = range.left; x <= range.right; ++x)
+            {
+                for (const auto& entry : getCell(x, y))
+                {
+                    // Only report the entry in the cell containing the top left corner of the intersection
+                    if (box.intersects(entry.box) && isReferenceCell(x, y, box, entry.box))
+                        f(entry.index);
+                }
+            }
+        }
+    }
+
+    // Call f(i, j) once for each pair of intersecting entries
+    template <typename F>
+    void findAllIntersections(F&& f) const
+    {
+        for (auto y = std::size_t(0); y < mNbRows; ++y)
+        {
+            for (auto x = std::size_t(0); x < mNbColumns; ++x)
+            {
+                const auto& cell = getCell(x, y);
+                for (auto i = std::size_t(0); i < cell.size(); ++i)
+                {
+                    for (auto j = std::size_t(0); j < i; ++j)
+                    {
+                        if (cell[i].box.intersects(cell[j].box) && isReferenceCell(x, y, cell[i].box, cell[j].box))
+                            f(cell[i].index, cell[j].index);
+                    }
+                }
+            }
+        }
+    }
+
+    // Visit the cells by increasing ring around searchBox and stop as soon as
+    // the remaining cells are farther than the best distance found so far
+    template <typename P>
+    std::pair<std::size_t, Float> findClosest(const Box<Float>& searchBox,
+        std::pair<std::size_t, Float> best, P&& predicate) const
+    {
+        auto range = getCellRange(searchBox);
+        auto maxRing = std::max(std::max(range.left, mNbColumns - 1 - range.right),
+            std::max(range.top, mNbRows - 1 - range.bottom));
+        auto minCellSize = std::min(mCellWidth, mCellHeight);
+        auto visitCell = [&](std::size_t x, std::size_t y)
+        {
+            if (distance(searchBox, getCellBox(x, y)) > best.second)
+                return;
+            for (const auto& entry : getCell(x, y))
+            {
+                auto currDist = distance(entry.box, searchBox);
+                if (currDist < best.second && predicate(entry.index, entry.box))
+                    best = std::make_pair(entry.index, currDist);
+            }
+        };
+        for (auto ring = std::size_t(0); ring <= maxRing; ++ring)
+        {
+            // Cells in this ring are separated from searchBox by at least ring - 1 cells
+            if (ring > 0 && static_cast<Float>(ring - 1) * minCellSize > best.second)
+                break;
+            auto left = range.left >= ring ? range.left - ring : std::size_t(0);
+            auto right = std::min(range.right + ring, mNbColumns - 1);
+            auto top = range.top >= ring ? range.top - ring : std::size_t(0);
+            auto bottom = std::min(range.bottom + ring, mNbRows - 1);
+            for (auto y = top; y <= bottom; ++y)
+            {
+                auto onHorizontalBorder = ring == 0 || y + ring == range.top || y == range.bottom + ring;
+                for (auto x = left; x <= right; ++x)
+                {
+                    if (onHorizontalBorder || x + ring == range.left || x == range.right + ring)
+                        visitCell(x, y);
+                }
+            }
+        }
+        return best;
+    }
+
+private:
+    struct CellRange
+    {
+        std::size_t left;
+        std::size_t top;
+        std::size_t right;
+        std::size_t bottom;
+    };
+
+    Box<Float> mBox;
+    std::size_t mNbColumns;
+    std::size_t mNbRows;
+    Float mCellWidth;
+    Float mCellHeight;
+    vector_type<vector_type<Entry>> mCells;
+
+    static std::size_t getCellCoordinate(Float x, Float origin, Float cellSize, std::size_t nbCells)
+    {
+        auto i = std::floor((x - origin) / cellSize);
+        if (!(i > 0))
+            return 0;
+        else if (i >= static_cast<Float>(nbCells - 1))
+            return nbCells - 1;
+        else
+            return static_cast<std::size_t>(i);
+    }
+
+    std::size_t getColumn(Float x) const
+    {
+        return getCellCoordinate(x, mBox.left, mCellWidth, mNbColumns);
+    }
+
+    std::size_t getRow(Float y) const
+    {
+        return getCellCoordinate(y, mBox.top, mCellHeight, mNbRows);
+    }
+
+    CellRange getCellRange(const Box<Float>& box) const
+    {
+        return CellRange{getColumn(box.left), getRow(box.top), getColumn(box.getRight()), getRow(box.getBottom())};
+    }
+
+    bool isReferenceCell(std::size_t x, std::size_t y, const Box<Float>& a, const Box<Float>& b) const
+    {
+        return getColumn(std::max(a.left, b.left)) == x && getRow(std::max(a.top, b.top)) == y;
+    }
+
+    vector_type<Entry>& getCell(std::size_t x, std::size_t y)
+    {
+        return mCells[y * mNbColumns + x];
+    }
+
+    const vector_type<Entry>& getCell(std::size_t x, std::size_t y) const
+    {
+        return mCells[y * mNbColumns + x];
+    }
+};
+
+}
+
+}
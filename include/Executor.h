@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<execution>)
+#include <execution>
+#endif
+#endif
+
+// Executors run the tasks of the parallel operations of the quadtree, the quadtree
+// never creates threads itself. An executor provides:
+//
+//     // Number of tasks that can run at the same time, used to split the work
+//     std::size_t getConcurrency() const;
+//     // Call f(i) for each i in [0, n), possibly concurrently, and return once they are all done
+//     template <typename F>
+//     void parallelFor(std::size_t n, F&& f);
+//
+// An adapter for another job system only has to implement these two methods.
+
+namespace quadtree
+{
+
+// Run the tasks in order on the calling thread
+class SequentialExecutor
+{
+public:
+    std::size_t getConcurrency() const
+    {
+        return 1;
+    }
+
+    template <typename F>
+    void parallelFor(std::size_t n, F&& f)
+    {
+        for (auto i = std::size_t(0); i < n; ++i)
+            f(i);
+    }
+};
+
+// Start threads for each call to parallelFor, the calling thread runs tasks too
+class ThreadExecutor
+{
+public:
+    explicit ThreadExecutor(std::size_t nbThreads = std::thread::hardware_concurrency()) :
+        mNbThreads(std::max<std::size_t>(nbThreads, 1))
+    {
+
+    }
+
+    std::size_t getConcurrency() const
+    {
+        return mNbThreads;
+    }
+
+    template <typename F>
+    void parallelFor(std::size_t n, F&& f)
+    {
+        std::atomic<std::size_t> next(0);
+        auto run = [&next, &f, n]()
+        {
+            for (auto i = next++; i < n; i = next++)
+                f(i);
+        };
+        auto threads = std::vector<std::thread>();
+        for (auto i = std::size_t(1); i < std::min(mNbThreads, n); ++i)
+            threads.emplace_back(run);
+        run();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+private:
+    std::size_t mNbThreads;
+};
+
+// Threads started once and reused by the calls to parallelFor, the calling thread
+// runs tasks too. The tasks must not call parallelFor on the same pool.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t nbThreads = std::thread::hardware_concurrency())
+    {
+        for (auto i = std::size_t(1); i < nbThreads; ++i)
+            mThreads.emplace_back([this](){ work(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            auto lock = std::unique_lock<std::mutex>(mMutex);
+            mStopping = true;
+        }
+        mJobAvailable.notify_all();
+        for (auto& thread : mThreads)
+            thread.join();
+    }
+
+    std::size_t getConcurrency() const
+    {
+        return mThreads.size() + 1;
+    }
+
+    template <typename F>
+    void parallelFor(std::size_t n, F&& f)
+    {
+        {
+            // Wait for the previous job, and for the workers that have not finished looking at it
+            auto lock = std::unique_lock<std::mutex>(mMutex);
+            mJobDone.wait(lock, [this](){ return !mRunning && mNbWorking == 0; });
+            mRunning = true;
+            mTask = [&f](std::size_t i){ f(i); };
+            mNbTasks = n;
+            mNext = 0;
+            ++mGeneration;
+        }
+        mJobAvailable.notify_all();
+        runTasks();
+        {
+            auto lock = std::unique_lock<std::mutex>(mMutex);
+            mJobDone.wait(lock, [this](){ return mNbWorking == 0; });
+            mRunning = false;
+            mTask = nullptr;
+        }
+        mJobDone.notify_all();
+    }
+
+private:
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mJobAvailable;
+    std::condition_variable mJobDone;
+    std::function<void(std::size_t)> mTask;
+    std::size_t mNbTasks = 0;
+    std::atomic<std::size_t> mNext{0};
+    std::size_t mGeneration = 0;
+    std::size_t mNbWorking = 0;
+    bool mRunning = false;
+    bool mStopping = false;
+
+    void work()
+    {
+        auto generation = std::size_t(0);
+        auto lock = std::unique_lock<std::mutex>(mMutex);
+        while (true)
+        {
+            mJobAvailable.wait(lock, [this, generation](){ return mStopping || mGeneration != generation; });
+            if (mStopping)
+                return;
+            generation = mGeneration;
+            ++mNbWorking;
+            lock.unlock();
+            runTasks();
+            lock.lock();
+            --mNbWorking;
+            if (mNbWorking == 0)
+                mJobDone.notify_all();
+        }
+    }
+
+    // The tasks are taken one at a time so that the threads stay busy with uneven tasks
+    void runTasks()
+    {
+        for (auto i = mNext++; i < mNbTasks; i = mNext++)
+            mTask(i);
+    }
+};
+
+#ifdef __cpp_lib_execution
+// Run the tasks with a standard execution policy such as std::execution::par
+template <typename Policy>
+class PolicyExecutor
+{
+public:
+    explicit PolicyExecutor(Policy policy = Policy()) : mPolicy(policy)
+    {
+
+    }
+
+    std::size_t getConcurrency() const
+    {
+        return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    template <typename F>
+    void parallelFor(std::size_t n, F&& f)
+    {
+        auto indices = std::vector<std::size_t>(n);
+        std::iota(std::begin(indices), std::end(indices), std::size_t(0));
+        std::for_each(mPolicy, std::begin(indices), std::end(indices), [&f](std::size_t i){ f(i); });
+    }
+
+private:
+    Policy mPolicy;
+};
+#endif
+
+}
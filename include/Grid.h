@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "Box.h"
+#include "CellIndex.h"
+
+namespace quadtree
+{
+
+// Uniform grid with the same interface as Quadtree, it is faster than a
+// quadtree when the values have similar sizes and are spread over a bounded area
+template<
+    typename T,
+    typename GetBox,
+    typename Equal = std::equal_to<T>,
+    typename Float = float,
+    template <typename> class Allocator = std::allocator
+>
+class Grid
+{
+#if __cplusplus < 201703L
+    static_assert(std::is_convertible<typename std::result_of<GetBox(const T&)>::type, Box<Float>>::value,
+#else
+    static_assert(std::is_convertible_v<std::invoke_result_t<GetBox, const T&>, Box<Float>>,
+#endif
+        "GetBox must be a callable of signature Box<Float>(const T&)");
+#if __cplusplus < 201703L
+    static_assert(std::is_convertible<typename std::result_of<Equal(const T&, const T&)>::type, bool>::value,
+#else
+    static_assert(std::is_convertible_v<std::invoke_result_t<Equal, const T&, const T&>, bool>,
+#endif
+        "Equal must be a callable of signature bool(const T&, const T&)");
+    static_assert(std::is_arithmetic<Float>::value, "is_arithmetic<Float> is false");
+
+public:
+    template <typename U>
+    using vector_type = std::vector< U, Allocator<U> >;
+
+    static constexpr auto DefaultResolution = std::size_t(64);
+
+    Grid(const Box<Float>& box, const GetBox& getBox = GetBox(),
+        const Equal& equal = Equal()) :
+        Grid(box, DefaultResolution, DefaultResolution, getBox, equal)
+    {
+
+    }
+
+    Grid(const Box<Float>& box, std::size_t nbColumns, std::size_t nbRows,
+        const GetBox& getBox = GetBox(), const Equal& equal = Equal()) :
+        mCells(box, nbColumns, nbRows), mGetBox(getBox), mEqual(equal)
+    {
+
+    }
+
+    void add(const T& value)
+    {
+        assert(area().contains(mGetBox(value)));
+        mCells.insert(mValues.size(), mGetBox(value));
+        mValues.push_back(value);
+    }
+
+    void remove(const T& value)
+    {
+        auto box = mGetBox(value);
+        auto i = mCells.find(box, [this, &value](std::size_t index){ return mEqual(value, mValues[index]); });
+        assert(i != Cells::npos && "Trying to remove a value that is not present in the grid");
+        mCells.erase(i, box);
+        // Swap with the last element and pop back
+        auto last = mValues.size() - 1;
+        if (i != last)
+        {
+            mCells.reindex(last, i, mGetBox(mValues[last]));
+            mValues[i] = std::move(mValues[last]);
+        }
+        mValues.pop_back();
+    }
+
+    vector_type<T> query(const Box<Float>& box) const
+    {
+        auto values = vector_type<T>();
+        mCells.query(box, [this, &values](std::size_t i){ values.push_back(mValues[i]); });
+        return values;
+    }
+
+    vector_type<std::pair<T, T>> findAllIntersections() const
+    {
+        auto intersections = vector_type<std::pair<T, T>>();
+        mCells.findAllIntersections([this, &intersections](std::size_t i, std::size_t j)
+        {
+            intersections.emplace_back(mValues[i], mValues[j]);
+        });
+        return intersections;
+    }
+
+    template <typename P>
+    const T* findClosest (const Box<Float>& box, P&& predicate) const
+    {
+        auto best = mCells.findClosest(
+            box,
+            {Cells::npos, std::abs(area().width) + std::abs(area().height)},
+            [this, &predicate](std::size_t i, const Box<Float>& valueBox){ return predicate(mValues[i], valueBox); }
+        );
+        return best.first != Cells::npos ? &mValues[best.first] : nullptr;
+    }
+
+    const T* findClosest (const Box<Float>& box) const
+    {
+        return findClosest(box, [](const T&, const Box<Float>&) {return true;});
+    }
+
+    const Box<Float>& area() const
+    {
+        return mCells.area();
+    }
+
+    MemoryUsage memoryUsage() const
+    {
+        auto usage = mCells.memoryUsage();
+        usage.values = mValues.size() * sizeof(T);
+        usage.slack += (mValues.capacity() - mValues.size()) * sizeof(T);
+        return usage;
+    }
+
+private:
+    using Cells = detail::CellIndex<Float, Allocator>;
+
+    vector_type<T> mValues;
+    Cells mCells;
+    GetBox mGetBox;
+    Equal mEqual;
+};
+
+}
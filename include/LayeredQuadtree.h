@@ -0,0 +1,171 @@
+#pragma once
+
+#include "BlockMakeUnique.h"
+#include "Executor.h"
+#include "Quadtree.h"
+
+namespace quadtree
+{
+
+// Values split in two layers: a static layer for the values that never move, built at
+// once and compacted into blocks, and a dynamic quadtree for the others. The queries look into both
+// layers, the intersections between two static values are never searched.
+template<
+    typename T,
+    typename GetBox,
+    typename Equal = std::equal_to<T>,
+    typename Float = float,
+    template <typename> class Allocator = std::allocator,
+    template <typename> class MakeUnique = detail::StdMakeUnique,
+    std::size_t LeafGridResolution = 0,
+    std::size_t Threshold = 16,
+    std::size_t MaxDepth = 8
+>
+class LayeredQuadtree
+{
+public:
+    using Layer = Quadtree<T, GetBox, Equal, Float, Allocator, MakeUnique, LeafGridResolution, Threshold, MaxDepth>;
+    // The nodes of the static layer are allocated in blocks (see BlockMakeUnique.h)
+    using StaticLayer = Quadtree<T, GetBox, Equal, Float, Allocator, BlockMakeUnique, LeafGridResolution, Threshold,
+        MaxDepth>;
+
+    template <typename U>
+    using vector_type = typename Layer::template vector_type<U>;
+
+    LayeredQuadtree(const Box<Float>& box, const GetBox& getBox = GetBox(),
+        const Equal& equal = Equal()) :
+        mStatic(box, getBox, equal), mDynamic(box, getBox, equal), mGetBox(getBox), mEqual(equal)
+    {
+
+    }
+
+    // Replace the values of the static layer, its nodes are laid out contiguously in
+    // van Emde Boas order as it is only read afterwards
+    template <typename Values, typename Executor>
+    void buildStatic(const Values& values, Executor& executor)
+    {
+        mStatic = StaticLayer(mDynamic.area(), mGetBox, mEqual);
+        mStatic.build(values, executor);
+        mStatic.compact(StaticLayer::NodeOrder::VanEmdeBoas);
+    }
+
+    template <typename Values>
+    void buildStatic(const Values& values)
+    {
+        auto executor = SequentialExecutor();
+        buildStatic(values, executor);
+    }
+
+    // The operations that modify values only apply to the dynamic layer
+
+    void add(const T& value)
+    {
+        mDynamic.add(value);
+    }
+
+    void remove(const T& value)
+    {
+        mDynamic.remove(value);
+    }
+
+    void update(const T& value, const Box<Float>& oldBox)
+    {
+        mDynamic.update(value, oldBox);
+    }
+
+    // The static values come first
+    vector_type<T> query(const Box<Float>& box) const
+    {
+        auto values = mStatic.query(box);
+        auto dynamicValues = mDynamic.query(box);
+        values.insert(std::end(values), std::begin(dynamicValues), std::end(dynamicValues));
+        return values;
+    }
+
+    // The static value is returned if both layers have a value at the same distance
+    template <typename P>
+    const T* findClosest(const Box<Float>& box, P&& predicate) const
+    {
+        auto staticValue = mStatic.findClosest(box, predicate);
+        auto dynamicValue = mDynamic.findClosest(box, predicate);
+        if (staticValue == nullptr)
+            return dynamicValue;
+        if (dynamicValue == nullptr)
+            return staticValue;
+        return distance(box, mGetBox(*dynamicValue)) < distance(box, mGetBox(*staticValue)) ? dynamicValue : staticValue;
+    }
+
+    const T* findClosest(const Box<Float>& box) const
+    {
+        return findClosest(box, [](const T&, const Box<Float>&) {return true;});
+    }
+
+    // The intersections between dynamic values, followed by the ones between a dynamic
+    // value and a static value in this order
+    vector_type<std::pair<T, T>> findAllIntersections() const
+    {
+        auto executor = SequentialExecutor();
+        return findAllIntersections(executor);
+    }
+
+    // Same intersections in the same order, see Quadtree for the executors
+    template <typename Executor>
+    vector_type<std::pair<T, T>> findAllIntersections(Executor& executor) const
+    {
+        auto intersections = mDynamic.findAllIntersections(executor);
+        auto dynamicValues = vector_type<T>();
+        auto boxes = vector_type<Box<Float>>();
+        mDynamic.forEachNode([this, &dynamicValues, &boxes](typename Layer::LocationalCode, const Box<Float>&,
+            const auto& values, bool)
+        {
+            for (const auto& value : values)
+            {
+                dynamicValues.push_back(value);
+                boxes.push_back(mGetBox(value));
+            }
+        });
+        auto results = mStatic.query(boxes, executor);
+        for (auto i = std::size_t(0); i < dynamicValues.size(); ++i)
+        {
+            for (const auto& other : results[i])
+                intersections.emplace_back(dynamicValues[i], other);
+        }
+        return intersections;
+    }
+
+    const Box<Float>& area() const
+    {
+        return mDynamic.area();
+    }
+
+    MemoryUsage memoryUsage() const
+    {
+        auto usage = mStatic.memoryUsage();
+        usage += mDynamic.memoryUsage();
+        return usage;
+    }
+
+    const StaticLayer& getStaticLayer() const
+    {
+        return mStatic;
+    }
+
+    // To configure the dynamic layer, for instance to enable hashing or maintenance
+    Layer& getDynamicLayer()
+    {
+        return mDynamic;
+    }
+
+    const Layer& getDynamicLayer() const
+    {
+        return mDynamic;
+    }
+
+private:
+    StaticLayer mStatic;
+    Layer mDynamic;
+    GetBox mGetBox;
+    Equal mEqual;
+};
+
+}
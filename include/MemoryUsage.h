@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+namespace quadtree
+{
+
+// Heap memory of a container in bytes, the overhead of the allocator is not included
+struct MemoryUsage
+{
+    std::size_t nodes = 0; // Node structures
+    std::size_t values = 0; // Used part of the value buffers
+    std::size_t slack = 0; // Unused capacity of the buffers
+    std::size_t indexes = 0; // Auxiliary indexes: leaf grids and hash table
+
+    std::size_t getTotal() const
+    {
+        return nodes + values + slack + indexes;
+    }
+
+    MemoryUsage& operator+=(const MemoryUsage& other)
+    {
+        nodes += other.nodes;
+        values += other.values;
+        slack += other.slack;
+        indexes += other.indexes;
+        return *this;
+    }
+};
+
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "MemoryUsage.h"
+
+namespace quadtree
+{
+
+// Pairs of intersecting values kept from one broadphase to the next with user data,
+// for instance the contact manifolds of a narrow phase. The pairs are canonicalised so
+// that (a, b) and (b, a) are the same pair. The table uses open addressing with linear
+// probing in a single array and backward shift deletion, it has no tombstones to
+// degrade the probes when the pairs churn.
+template<
+    typename T,
+    typename Data,
+    typename Hash = std::hash<T>,
+    typename Equal = std::equal_to<T>,
+    typename Less = std::less<T>,
+    template <typename> class Allocator = std::allocator
+>
+class PairCache
+{
+public:
+    template <typename U>
+    using vector_type = std::vector< U, Allocator<U> >;
+
+    explicit PairCache(const Hash& hash = Hash(), const Equal& equal = Equal(), const Less& less = Less()) :
+        mHash(hash), mEqual(equal), mLess(less)
+    {
+
+    }
+
+    // Update the cache with the pairs found by a broadphase: onBegin(a, b, data) is called
+    // for the new pairs, onPersist(a, b, data) for the pairs that were already there and
+    // onEnd(a, b, data) for the pairs that are not found anymore, which are then removed.
+    // The new pairs start with a value-initialized data. The references to the data are
+    // only valid during the calls.
+    template <typename Pairs, typename Begin, typename Persist, typename End>
+    void update(const Pairs& pairs, Begin&& onBegin, Persist&& onPersist, End&& onEnd)
+    {
+        nextFrame();
+        for (const auto& pair : pairs)
+        {
+            auto canonicalPair = canonicalise(pair.first, pair.second);
+            auto inserted = false;
+            auto& slot = findOrInsert(canonicalPair.first, canonicalPair.second, inserted);
+            // Reported twice by the broadphase
+            if (!inserted && slot.frame == mFrame)
+                continue;
+            slot.frame = mFrame;
+            if (inserted)
+                onBegin(slot.first, slot.second, slot.data);
+            else
+                onPersist(slot.first, slot.second, slot.data);
+        }
+        // Remove the pairs that were not found, a slot is visited again after a removal
+        // as the next slot of its cluster may have been shifted into it
+        for (auto i = std::size_t(0); i < mSlots.size();)
+        {
+            auto& slot = mSlots[i];
+            if (slot.frame != EmptyFrame && slot.frame != mFrame)
+            {
+                onEnd(slot.first, slot.second, slot.data);
+                erase(i);
+            }
+            else
+                ++i;
+        }
+    }
+
+    template <typename Pairs>
+    void update(const Pairs& pairs)
+    {
+        auto ignore = [](const T&, const T&, Data&){};
+        update(pairs, ignore, ignore, ignore);
+    }
+
+    // Data of the pair, nullptr if the pair is not in the cache
+    Data* find(const T& a, const T& b)
+    {
+        auto i = findIndex(canonicalise(a, b));
+        return i != npos ? &mSlots[i].data : nullptr;
+    }
+
+    const Data* find(const T& a, const T& b) const
+    {
+        auto i = findIndex(canonicalise(a, b));
+        return i != npos ? &mSlots[i].data : nullptr;
+    }
+
+    // Call f(a, b, data) for each pair, in no particular order
+    template <typename F>
+    void forEach(F&& f)
+    {
+        for (auto& slot : mSlots)
+        {
+            if (slot.frame != EmptyFrame)
+                f(slot.first, slot.second, slot.data);
+        }
+    }
+
+    std::size_t size() const
+    {
+        return mSize;
+    }
+
+    bool empty() const
+    {
+        return mSize == 0;
+    }
+
+    void clear()
+    {
+        mSlots = vector_type<Slot>();
+        mSize = 0;
+    }
+
+    // Make room for nbPairs pairs without growing
+    void reserve(std::size_t nbPairs)
+    {
+        auto capacity = std::max(mSlots.size(), MinCapacity);
+        while (isOverloaded(nbPairs, capacity))
+            capacity *= 2;
+        if (capacity != mSlots.size())
+            rehash(capacity);
+    }
+
+    MemoryUsage memoryUsage() const
+    {
+        auto usage = MemoryUsage();
+        usage.values = mSize * sizeof(Slot);
+        usage.slack = (mSlots.capacity() - mSize) * sizeof(Slot);
+        return usage;
+    }
+
+private:
+    // Frame of the slots that are not used, the frames of the updates start at 1
+    static constexpr auto EmptyFrame = std::uint32_t(0);
+    static constexpr auto MinCapacity = std::size_t(16);
+    static constexpr auto npos = std::numeric_limits<std::size_t>::max();
+
+    struct Slot
+    {
+        T first;
+        T second;
+        std::uint32_t frame = EmptyFrame; // Last update that found the pair
+        Data data = Data();
+    };
+
+    vector_type<Slot> mSlots; // The capacity is a power of two
+    std::size_t mSize = 0;
+    std::uint32_t mFrame = EmptyFrame;
+    Hash mHash;
+    Equal mEqual;
+    Less mLess;
+
+    // The load factor stays below 3/4, linear probing degrades quickly above
+    static bool isOverloaded(std::size_t size, std::size_t capacity)
+    {
+        return 4 * size > 3 * capacity;
+    }
+
+    std::pair<T, T> canonicalise(const T& a, const T& b) const
+    {
+        return mLess(b, a) ? std::pair<T, T>(b, a) : std::pair<T, T>(a, b);
+    }
+
+    // The hashes of pointers are their addresses, their low bits are mixed in the whole word
+    std::size_t getIndex(const T& a, const T& b) const
+    {
+        std::uint64_t x = mHash(a);
+        x = x * 0x9e3779b97f4a7c15ull + mHash(b);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return x & (mSlots.size() - 1);
+    }
+
+    void nextFrame()
+    {
+        ++mFrame;
+        // Renumber the frames before they wrap around to the empty frame, the pairs
+        // left are the ones found by the previous update
+        if (mFrame == std::numeric_limits<std::uint32_t>::max())
+        {
+            for (auto& slot : mSlots)
+            {
+                if (slot.frame != EmptyFrame)
+                    slot.frame = 1;
+            }
+            mFrame = 2;
+        }
+    }
+
+    std::size_t findIndex(const std::pair<T, T>& pair) const
+    {
+        if (mSlots.empty())
+            return npos;
+        for (auto i = getIndex(pair.first, pair.second);; i = (i + 1) & (mSlots.size() - 1))
+        {
+            const auto& slot = mSlots[i];
+            if (slot.frame == EmptyFrame)
+                return npos;
+            if (mEqual(slot.first, pair.first) && mEqual(slot.second, pair.second))
+                return i;
+        }
+    }
+
+    Slot& findOrInsert(const T& a, const T& b, bool& inserted)
+    {
+        if (mSlots.empty() || isOverloaded(mSize + 1, mSlots.size()))
+            rehash(std::max(2 * mSlots.size(), MinCapacity));
+        for (auto i = getIndex(a, b);; i = (i + 1) & (mSlots.size() - 1))
+        {
+            auto& slot = mSlots[i];
+            if (slot.frame == EmptyFrame)
+            {
+                slot.first = a;
+                slot.second = b;
+                ++mSize;
+                inserted = true;
+                return slot;
+            }
+            if (mEqual(slot.first, a) && mEqual(slot.second, b))
+                return slot;
+        }
+    }
+
+    // Fill the hole with the next slots of the cluster that do not have to stay after it
+    void erase(std::size_t hole)
+    {
+        auto mask = mSlots.size() - 1;
+        for (auto i = (hole + 1) & mask; mSlots[i].frame != EmptyFrame; i = (i + 1) & mask)
+        {
+            auto home = getIndex(mSlots[i].first, mSlots[i].second);
+            // The slot can move if its home is not in (hole, i]
+            if (((i - home) & mask) >= ((i - hole) & mask))
+            {
+                mSlots[hole] = std::move(mSlots[i]);
+                hole = i;
+            }
+        }
+        // Release the resources of the data now
+        mSlots[hole].frame = EmptyFrame;
+        mSlots[hole].data = Data();
+        --mSize;
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        auto slots = vector_type<Slot>(capacity);
+        std::swap(slots, mSlots);
+        for (auto& slot : slots)
+        {
+            if (slot.frame == EmptyFrame)
+                continue;
+            for (auto i = getIndex(slot.first, slot.second);; i = (i + 1) & (capacity - 1))
+            {
+                if (mSlots[i].frame == EmptyFrame)
+                {
+                    mSlots[i] = std::move(slot);
+                    break;
+                }
+            }
+        }
+    }
+};
+
+}
@@ -2,10 +2,21 @@
 
 #include <cassert>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 #include "Box.h"
+#include "CellIndex.h"
+#include "MemoryUsage.h"
 
 namespace quadtree
 {
@@ -21,6 +32,84 @@ namespace detail
             return std::make_unique<T>(std::forward<Args>(args)...);
         }
     };
+
+    // Pointer to the grids of the leaves, MakeUnique is only required to construct
+    // them when the leaves have grids
+    template <typename Grid, template <typename> class MakeUnique, typename Float, bool HasGrids>
+    struct GridPointer
+    {
+        using type = std::unique_ptr<Grid>;
+    };
+
+    template <typename Grid, template <typename> class MakeUnique, typename Float>
+    struct GridPointer<Grid, MakeUnique, Float, true>
+    {
+#if __cplusplus < 201703L
+        using type = typename std::result_of<MakeUnique<Grid>(const Box<Float>&, std::size_t, std::size_t)>::type;
+#else
+        using type = std::invoke_result_t<MakeUnique<Grid>, const Box<Float>&, std::size_t, std::size_t>;
+#endif
+    };
+
+    // Recorder that does not record anything
+    struct NoRecorder
+    {
+        template <typename Float>
+        void onAdd(const Box<Float>&) {}
+        template <typename Float>
+        void onRemove(const Box<Float>&) {}
+        template <typename Float>
+        void onUpdate(const Box<Float>&, const Box<Float>&) {}
+        template <typename Float>
+        void onQuery(const Box<Float>&) {}
+        void onFindAllIntersections() {}
+    };
+
+    // Mutex that stays with its quadtree when the quadtree is moved
+    struct QuadtreeMutex : std::mutex
+    {
+        QuadtreeMutex() = default;
+
+        QuadtreeMutex(QuadtreeMutex&&) noexcept
+        {
+
+        }
+
+        QuadtreeMutex& operator=(QuadtreeMutex&&) noexcept
+        {
+            return *this;
+        }
+    };
+
+    // Insert a zero bit between each bit of x
+    inline std::uint64_t spreadBits(std::uint32_t x)
+    {
+        auto r = static_cast<std::uint64_t>(x);
+        r = (r | (r << 16)) & 0x0000FFFF0000FFFFull;
+        r = (r | (r << 8)) & 0x00FF00FF00FF00FFull;
+        r = (r | (r << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        r = (r | (r << 2)) & 0x3333333333333333ull;
+        r = (r | (r << 1)) & 0x5555555555555555ull;
+        return r;
+    }
+
+    // Inverse of spreadBits, the odd bits are ignored
+    inline std::uint32_t compactBits(std::uint64_t r)
+    {
+        r &= 0x5555555555555555ull;
+        r = (r | (r >> 1)) & 0x3333333333333333ull;
+        r = (r | (r >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+        r = (r | (r >> 4)) & 0x00FF00FF00FF00FFull;
+        r = (r | (r >> 8)) & 0x0000FFFF0000FFFFull;
+        r = (r | (r >> 16)) & 0x00000000FFFFFFFFull;
+        return static_cast<std::uint32_t>(r);
+    }
+
+    // Morton code of (x, y), the bits of x are in the even positions
+    inline std::uint64_t interleaveBits(std::uint32_t x, std::uint32_t y)
+    {
+        return spreadBits(x) | (spreadBits(y) << 1);
+    }
 }
 
 template<
@@ -29,7 +118,11 @@ template<
     typename Equal = std::equal_to<T>,
     typename Float = float,
     template <typename> class Allocator = std::allocator,
-    template <typename> class MakeUnique = detail::StdMakeUnique
+    template <typename> class MakeUnique = detail::StdMakeUnique,
+    std::size_t LeafGridResolution = 0,
+    std::size_t Threshold = 16,
+    std::size_t MaxDepth = 8,
+    typename Recorder = detail::NoRecorder
 >
 class Quadtree
 {
@@ -51,25 +144,111 @@ public:
     template <typename U>
     using vector_type = std::vector< U, Allocator<U> >;
 
+    // Aggregate of the values stored in a node
+    struct NodeSummary
+    {
+        Box<Float> box; // Cell of the node
+        Box<Float> bounds; // Union of the boxes of the values
+        std::size_t count;
+        const T* representative;
+        std::size_t depth;
+    };
+
+    // Health of the tree, degrading under churn
+    struct Health
+    {
+        std::size_t nbNodes = 0;
+        std::size_t nbLeaves = 0;
+        std::size_t nbEmptyLeaves = 0;
+        std::size_t nbStraddlers = 0; // Values stored in interior nodes
+        std::size_t nbOverflowingLeaves = 0; // Leaves at MaxDepth with more than Threshold values and no grid
+        std::size_t nbUnderfullNodes = 0; // Interior nodes whose subtree fits in a leaf
+        std::size_t maxDepth = 0;
+    };
+
+    // Collapse of the interior nodes left underfull by the removals, tryMerge only
+    // merges a node whose children are all leaves
+    struct MaintenancePolicy
+    {
+        bool enabled = false;
+        // An interior node is collapsed once its subtree holds at most this many
+        // values, lower than Threshold to not split and collapse back and forth
+        std::size_t collapseThreshold = Threshold / 2;
+        // Collapse the nodes at the end of remove and update, otherwise in maintain
+        bool automatic = true;
+    };
+
+    // Order of the nodes in memory after compact
+    enum class NodeOrder
+    {
+        BreadthFirst,
+        VanEmdeBoas // Recursively the top half of the levels, then the subtrees below
+    };
+
+    // Path from the root to a node: a leading 1 followed by the index of the
+    // quadrant taken at each level, the code of the root is 1
+    using LocationalCode = std::uint64_t;
+
     Quadtree(const Box<Float>& box, const GetBox& getBox = GetBox(),
         const Equal& equal = Equal()) :
-        mBox(box), mMakeUnique(), mRoot(mMakeUnique()), mGetBox(getBox), mEqual(equal)
+        mBox(box), mMakeUnique(), mMakeGrid(), mRoot(mMakeUnique()), mGetBox(getBox), mEqual(equal)
     {
 
     }
 
     void add(const T& value)
     {
-        add(mRoot.get(), 0, mBox, value);
+        if (IsRecording)
+            mRecorder.onAdd(mGetBox(value));
+        add(mRoot.get(), RootCode, 0, mBox, value);
     }
 
     void remove(const T& value)
     {
-        remove(mRoot.get(), nullptr, mBox, value);
+        auto box = mGetBox(value);
+        if (IsRecording)
+            mRecorder.onRemove(box);
+        remove(mRoot.get(), nullptr, RootCode, mBox, value, box);
+        if (mMaintenance.enabled && mMaintenance.automatic)
+            maintain();
+    }
+
+    // Move a value whose box was oldBox to its current box, the other values
+    // must still have the boxes they were added or updated with
+    void update(const T& value, const Box<Float>& oldBox)
+    {
+        auto newBox = mGetBox(value);
+        assert(mBox.contains(newBox));
+        if (IsRecording)
+            mRecorder.onUpdate(oldBox, newBox);
+        if (mHashing)
+        {
+            // Slow movers usually stay in the same node, find it without descending the tree
+            auto location = locateNode(oldBox);
+            if (isLocationOf(location, newBox))
+            {
+                updateValue(location.node, value, oldBox, newBox);
+                // Update the bounds from the bottom up, until a node whose bounds are unchanged
+                if (moveInSummary(location.node, oldBox, newBox))
+                {
+                    for (auto code = location.code >> 2; code != 0; code >>= 2)
+                    {
+                        if (!moveInSummary(mNodes.at(code), oldBox, newBox))
+                            break;
+                    }
+                }
+                return;
+            }
+        }
+        update(mRoot.get(), RootCode, 0, mBox, value, oldBox, newBox);
+        if (mMaintenance.enabled && mMaintenance.automatic)
+            maintain();
     }
 
     vector_type<T> query(const Box<Float>& box) const
     {
+        if (IsRecording)
+            mRecorder.onQuery(box);
         auto values = vector_type<T>();
         query(mRoot.get(), mBox, box, values);
         return values;
@@ -77,17 +256,167 @@ public:
 
     vector_type<std::pair<T, T>> findAllIntersections() const
     {
+        if (IsRecording)
+            mRecorder.onFindAllIntersections();
         auto intersections = vector_type<std::pair<T, T>>();
         findAllIntersections(mRoot.get(), intersections);
         return intersections;
     }
 
+    // Parallel operations, their tasks run on executor (see Executor.h) so GetBox must be
+    // safe to call from several threads, and MakeUnique must be copyable as each task of
+    // build allocates through its own copies of the policies. Their results are the ones of
+    // the serial operations, in the same order, whatever the executor and the number of
+    // threads: each task writes to its own buffer and the buffers are merged in tree order
+
+    // Add the values in order, an empty quadtree is built top-down with a task per subtree,
+    // the nodes and the order of their values are the same as with add
+    template <typename Values, typename Executor>
+    void build(const Values& values, Executor& executor)
+    {
+        if (mRoot->count > 0 || !isLeaf(mRoot.get()))
+        {
+            for (const auto& value : values)
+                add(value);
+            return;
+        }
+        if (IsRecording)
+        {
+            for (const auto& value : values)
+                mRecorder.onAdd(mGetBox(value));
+        }
+        // Split the top of the tree on the calling thread until there are enough subtrees
+        auto nbTasks = TasksPerThread * executor.getConcurrency();
+        auto items = vector_type<BuildItem>();
+        items.push_back(BuildItem{mRoot.get(), 0, mBox, vector_type<T>(std::begin(values), std::end(values))});
+        while (!items.empty() && items.size() < nbTasks)
+        {
+            auto nextItems = vector_type<BuildItem>();
+            for (auto& item : items)
+            {
+                auto childValues = std::array<vector_type<T>, 4>();
+                if (!fillNode(item.node, item.depth, item.box, item.values, childValues, mMakeGrid))
+                    continue;
+                for (auto i = std::size_t(0); i < item.node->children.size(); ++i)
+                {
+                    item.node->children[i] = createNode();
+                    nextItems.push_back(BuildItem{item.node->children[i].get(), item.depth + 1,
+                        computeBox(item.box, static_cast<int>(i)), std::move(childValues[i])});
+                }
+            }
+            items = std::move(nextItems);
+        }
+        // Share the spare nodes between the tasks in proportion to their values
+        auto nbValues = std::size_t(0);
+        for (const auto& item : items)
+            nbValues += item.values.size();
+        auto nbSpareNodes = mSpareNodes.size();
+        auto tasks = vector_type<BuildTask>();
+        tasks.reserve(items.size());
+        auto nbPrecedingValues = std::size_t(0);
+        for (const auto& item : items)
+        {
+            tasks.push_back(BuildTask{mMakeUnique, mMakeGrid, vector_type<UniqueNodePtr>()});
+            nbPrecedingValues += item.values.size();
+            auto end = nbValues > 0 ? nbSpareNodes - nbSpareNodes * nbPrecedingValues / nbValues : nbSpareNodes;
+            while (mSpareNodes.size() > end)
+            {
+                tasks.back().spareNodes.push_back(std::move(mSpareNodes.back()));
+                mSpareNodes.pop_back();
+            }
+        }
+        executor.parallelFor(items.size(), [this, &items, &tasks](std::size_t i)
+        {
+            auto& item = items[i];
+            buildSubtree(item.node, item.depth, item.box, item.values, tasks[i]);
+        });
+        // The nodes left are kept for the next splits
+        for (auto& task : tasks)
+        {
+            for (auto& node : task.spareNodes)
+                mSpareNodes.push_back(std::move(node));
+        }
+        if (mHashing)
+            addToHashTable(mRoot.get(), RootCode);
+    }
+
+    // The values intersecting boxes[i] are in the i-th vector, in the order of query(boxes[i])
+    template <typename Boxes, typename Executor>
+    vector_type<vector_type<T>> query(const Boxes& boxes, Executor& executor) const
+    {
+        if (IsRecording)
+        {
+            for (const auto& box : boxes)
+                mRecorder.onQuery(box);
+        }
+        auto results = vector_type<vector_type<T>>(boxes.size());
+        // Contiguous ranges of boxes, several per thread to balance the load
+        auto nbTasks = std::min(boxes.size(), TasksPerThread * executor.getConcurrency());
+        executor.parallelFor(nbTasks, [this, &boxes, &results, nbTasks](std::size_t task)
+        {
+            auto end = (task + 1) * boxes.size() / nbTasks;
+            for (auto i = task * boxes.size() / nbTasks; i < end; ++i)
+                query(mRoot.get(), mBox, boxes[i], results[i]);
+        });
+        return results;
+    }
+
+    // Same intersections in the same order as findAllIntersections()
+    template <typename Executor>
+    vector_type<std::pair<T, T>> findAllIntersections(Executor& executor) const
+    {
+        if (IsRecording)
+            mRecorder.onFindAllIntersections();
+        auto tasks = vector_type<IntersectionTask>();
+        addIntersectionTasks(mRoot.get(), 0, getTaskDepth(TasksPerThread * executor.getConcurrency()), tasks);
+        auto buffers = vector_type<vector_type<std::pair<T, T>>>(tasks.size());
+        executor.parallelFor(tasks.size(), [this, &tasks, &buffers](std::size_t i)
+        {
+            runIntersectionTask(tasks[i], buffers[i]);
+        });
+        // The buffers are concatenated in the order of the serial traversal
+        auto nbIntersections = std::size_t(0);
+        for (const auto& buffer : buffers)
+            nbIntersections += buffer.size();
+        auto intersections = vector_type<std::pair<T, T>>();
+        intersections.reserve(nbIntersections);
+        for (auto& buffer : buffers)
+            std::move(std::begin(buffer), std::end(buffer), std::back_inserter(intersections));
+        return intersections;
+    }
+
+    class QueryCursor;
+    class IntersectionCursor;
+
+    // Query run in several steps with a cursor, see QueryCursor
+    QueryCursor startQuery(const Box<Float>& box) const
+    {
+        if (IsRecording)
+            mRecorder.onQuery(box);
+        return QueryCursor(*this, box);
+    }
+
+    // findAllIntersections run in several steps with a cursor, see IntersectionCursor
+    IntersectionCursor startFindAllIntersections() const
+    {
+        if (IsRecording)
+            mRecorder.onFindAllIntersections();
+        return IntersectionCursor(*this);
+    }
+
     template <typename P>
     const T* findClosest (const Box<Float>& box, P&& predicate) const
     {
+        auto best = std::pair<const T*, Float>(nullptr, std::abs(mBox.width) + std::abs(mBox.height));
+        // Start with the leaf of the query to have a tight bound early
+        if (mHashing)
+        {
+            auto location = locateNode(Box<Float>(box.getCenter(), Vector2<Float>()));
+            best = findClosestInNode(box, best, *location.node, predicate);
+        }
         return findClosestImpl(
             box,
-            {nullptr, std::abs(mBox.width) + std::abs(mBox.height)},
+            best,
             *mRoot,
             mBox,
             std::forward<P>(predicate)
@@ -99,14 +428,354 @@ public:
         return findClosest(box, [](const T&, const Box<Float>&) {return true;});
     }
 
+    // Whether value is in the quadtree, box is the box the value was added or updated with
+    bool contains(const T& value, const Box<Float>& box) const
+    {
+        auto node = mRoot.get();
+        auto nodeBox = mBox;
+        while (true)
+        {
+            if (node->grid)
+                return findInGrid(node, value, box) != LeafGrid::npos;
+            for (const auto& other : node->values)
+            {
+                if (mEqual(value, other))
+                    return true;
+            }
+            if (isLeaf(node))
+                return false;
+            auto i = getQuadrant(nodeBox, box);
+            if (i == -1)
+                return false;
+            node = node->children[static_cast<std::size_t>(i)].get();
+            nodeBox = computeBox(nodeBox, i);
+        }
+    }
+
+    bool contains(const T& value) const
+    {
+        return contains(value, mGetBox(value));
+    }
+
 	const Box<Float>& area() const
 	{
 		return mBox;
 	}
 
+    // Code of the leaf containing point
+    LocationalCode locate(const Vector2<Float>& point) const
+    {
+        return locateNode(Box<Float>(point, Vector2<Float>())).code;
+    }
+
+    // Maintain a hash table from locational codes to nodes, it makes point
+    // location a binary search over the depths instead of a descent
+    void setHashingEnabled(bool enabled)
+    {
+        mHashing = enabled;
+        mNodes.clear();
+        if (mHashing)
+            addToHashTable(mRoot.get(), RootCode);
+    }
+
+    bool isHashingEnabled() const
+    {
+        return mHashing;
+    }
+
+    // The size of the hash table is estimated from a node per entry and a pointer per bucket
+    MemoryUsage memoryUsage() const
+    {
+        auto usage = MemoryUsage();
+        memoryUsage(mRoot.get(), usage);
+        usage.slack += mSpareNodes.capacity() * sizeof(UniqueNodePtr);
+        for (const auto& node : mSpareNodes)
+            usage.slack += sizeof(Node) + node->values.capacity() * sizeof(T);
+        if (!mNodes.empty())
+        {
+            usage.indexes += mNodes.bucket_count() * sizeof(void*) +
+                mNodes.size() * (sizeof(void*) + sizeof(typename HashTable::value_type));
+        }
+        return usage;
+    }
+
+    // Allocate ahead the nodes and the value buffers of a tree holding expectedCount
+    // values, assuming half full leaves, so that the splits do not allocate. The nodes
+    // released by the merges are kept for the next splits up to this number of nodes.
+    void reserve(std::size_t expectedCount)
+    {
+        auto nbLeaves = std::max<std::size_t>(2 * expectedCount / Threshold, 1);
+        // Each split turns a leaf into an interior node and four leaves
+        mNbReservedNodes = nbLeaves + nbLeaves / 3;
+        auto nbNodes = getNbNodes(mRoot.get());
+        auto nbSpareNodes = mNbReservedNodes > nbNodes ? mNbReservedNodes - nbNodes : std::size_t(0);
+        mSpareNodes.reserve(nbSpareNodes);
+        while (mSpareNodes.size() < nbSpareNodes)
+        {
+            mSpareNodes.push_back(mMakeUnique());
+            mSpareNodes.back()->values.reserve(Threshold);
+        }
+        if (isLeaf(mRoot.get()))
+            mRoot->values.reserve(Threshold);
+        if (mHashing)
+            mNodes.reserve(mNbReservedNodes);
+    }
+
+    // Release the reserved nodes and the unused capacity of the buffers, for
+    // instance after a load spike
+    void shrinkToFit()
+    {
+        mNbReservedNodes = 0;
+        mSpareNodes = vector_type<UniqueNodePtr>();
+        shrinkToFit(mRoot.get());
+        mPendingCollapses.shrink_to_fit();
+        if (mHashing)
+            mNodes.rehash(0);
+    }
+
+    // Reallocate the nodes in order with new MakeUnique policies, and their values
+    // shrunk to fit. With BlockMakeUnique (see BlockMakeUnique.h) the nodes are laid out
+    // contiguously in this order, with StdMakeUnique it depends on the allocator. The
+    // spare nodes are reallocated after the tree, the hash table and the leaf grids are
+    // rebuilt. Meant for quiet periods of long-running processes, return the duration
+    // of the compaction.
+    std::chrono::steady_clock::duration compact(NodeOrder order = NodeOrder::BreadthFirst)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto nodes = vector_type<OrderedNode>();
+        if (order == NodeOrder::BreadthFirst)
+        {
+            nodes.push_back(OrderedNode{mRoot.get(), 0, 0});
+            for (auto i = std::size_t(0); i < nodes.size(); ++i)
+            {
+                auto node = nodes[i].node;
+                if (!isLeaf(node))
+                {
+                    for (auto j = std::size_t(0); j < node->children.size(); ++j)
+                        nodes.push_back(OrderedNode{node->children[j].get(), i, j});
+                }
+            }
+        }
+        else
+        {
+            auto frontier = vector_type<std::size_t>();
+            addVanEmdeBoasOrder(mRoot.get(), 0, 0, getHeight(mRoot.get()), nodes, frontier);
+        }
+        auto makeUnique = MakeUnique<Node>();
+        auto makeGrid = MakeUnique<LeafGrid>();
+        auto newNodes = vector_type<UniqueNodePtr>();
+        newNodes.reserve(nodes.size());
+        for (const auto& node : nodes)
+            newNodes.push_back(copyNode(node.node, makeUnique, makeGrid));
+        auto spareNodes = vector_type<UniqueNodePtr>();
+        spareNodes.reserve(mSpareNodes.size());
+        for (const auto& node : mSpareNodes)
+        {
+            spareNodes.push_back(makeUnique());
+            spareNodes.back()->values.reserve(node->values.capacity());
+        }
+        // Link the new nodes, the parents come before their children in both orders
+        for (auto i = nodes.size(); i-- > 1;)
+            newNodes[nodes[i].parent]->children[nodes[i].child] = std::move(newNodes[i]);
+        mRoot = std::move(newNodes.front());
+        mSpareNodes = std::move(spareNodes);
+        mMakeUnique = std::move(makeUnique);
+        mMakeGrid = std::move(makeGrid);
+        if (mHashing)
+        {
+            mNodes = HashTable();
+            mNodes.reserve(nodes.size());
+            addToHashTable(mRoot.get(), RootCode);
+        }
+        return std::chrono::steady_clock::now() - start;
+    }
+
+    // The underfull nodes are detected during the removals, enabling the policy
+    // looks for the ones already in the tree
+    void setMaintenancePolicy(const MaintenancePolicy& policy)
+    {
+        assert(policy.collapseThreshold <= Threshold);
+        mMaintenance = policy;
+        mPendingCollapses.clear();
+        if (mMaintenance.enabled)
+        {
+            addPendingCollapses(mRoot.get(), RootCode);
+            if (mMaintenance.automatic)
+                maintain();
+        }
+    }
+
+    const MaintenancePolicy& getMaintenancePolicy() const
+    {
+        return mMaintenance;
+    }
+
+    std::size_t getNbPendingCollapses() const
+    {
+        return mPendingCollapses.size();
+    }
+
+    // Collapse at most maxCollapses pending nodes, the latest first as they are the
+    // highest in the tree. Return the number of nodes still pending.
+    std::size_t maintain(std::size_t maxCollapses = std::numeric_limits<std::size_t>::max())
+    {
+        for (auto i = std::size_t(0); i < maxCollapses && !mPendingCollapses.empty(); ++i)
+        {
+            auto code = mPendingCollapses.back();
+            mPendingCollapses.pop_back();
+            // The node may have been collapsed with an ancestor or have grown since
+            auto node = descend(code);
+            if (node != nullptr && !isLeaf(node) && node->count <= mMaintenance.collapseThreshold)
+                collapse(node, code);
+        }
+        return mPendingCollapses.size();
+    }
+
+    // Traverse the whole tree, meant for monitoring
+    Health getHealth() const
+    {
+        auto health = Health();
+        computeHealth(mRoot.get(), 0, health);
+        return health;
+    }
+
+    Recorder& getRecorder()
+    {
+        return mRecorder;
+    }
+
+    const Recorder& getRecorder() const
+    {
+        return mRecorder;
+    }
+
+    // Draw k values intersecting box uniformly at random, with replacement. The
+    // nodes fully covered by box are sampled with their counts, only the values
+    // of the nodes on the border of box are drawn with rejection.
+    template <typename URBG>
+    vector_type<T> sample(const Box<Float>& box, std::size_t k, URBG& generator) const
+    {
+        auto values = vector_type<T>();
+        auto sampler = Sampler();
+        if (k == 0 || !box.intersects(mBox))
+            return values;
+        prepareSampler(mRoot.get(), mBox, box, false, sampler);
+        values.reserve(k);
+        auto nbRejections = std::size_t(0);
+        while (values.size() < k && sampler.total > 0)
+        {
+            auto r = std::uniform_int_distribution<std::size_t>(0, sampler.total - 1)(generator);
+            auto it = std::upper_bound(std::begin(sampler.ends), std::end(sampler.ends), r);
+            auto i = static_cast<std::size_t>(std::distance(std::begin(sampler.ends), it));
+            r -= i > 0 ? sampler.ends[i - 1] : 0;
+            const auto& item = sampler.items[i];
+            if (item.node == nullptr)
+                values.push_back(*sampler.filtered[r]);
+            else if (item.covered)
+                values.push_back(drawValue(item.node, r));
+            else if (box.intersects(mGetBox(item.node->values[r])))
+                values.push_back(item.node->values[r]);
+            // Too many rejections, keep only the values of the border that intersect box
+            else if (++nbRejections > MaxRejectionsPerSample * k)
+                filterSampler(box, sampler);
+        }
+        return values;
+    }
+
+    // Call f(summary) for each node whose cell intersects box, stopping at
+    // maxDepth. The nodes at maxDepth and the leaves above summarize their
+    // whole subtree, the interior nodes above only summarize their own values
+    // (the ones that are not contained in a child). The summaries are not
+    // clipped to box. The bounds left stale by the removals and the updates
+    // are recomputed here under a mutex, so that queryLod can run concurrently
+    // with itself and the other const operations.
+    template <typename F>
+    void queryLod(const Box<Float>& box, std::size_t maxDepth, F&& f) const
+    {
+        if (box.intersects(mBox))
+            queryLod(mRoot.get(), 0, mBox, box, maxDepth, f);
+    }
+
+    // Deepest level whose cells are at least minCellSize wide and high
+    std::size_t getLodDepth(Float minCellSize) const
+    {
+        auto depth = std::size_t(0);
+        auto size = std::min(mBox.width, mBox.height);
+        while (depth < MaxDepth && size / 2 >= minCellSize)
+        {
+            size /= 2;
+            ++depth;
+        }
+        return depth;
+    }
+
+    // Call f(code, box, values) for each leaf
+    template <typename F>
+    void forEachLeaf(F&& f) const
+    {
+        forEachLeaf(mRoot.get(), RootCode, mBox, f);
+    }
+
+    // Call f(code, box, values, leaf) for each node in depth-first order, the
+    // values of an interior node are the ones straddling its children
+    template <typename F>
+    void forEachNode(F&& f) const
+    {
+        forEachNode(mRoot.get(), RootCode, mBox, f);
+    }
+
+    // Call f(code, box, values) once for each leaf sharing an edge or a corner
+    // with the cell of code, usually a code returned by locate
+    template <typename F>
+    void forEachNeighbour(LocationalCode code, F&& f) const
+    {
+        auto depth = getDepth(code);
+        auto nbCells = std::int64_t(1) << depth;
+        auto morton = code ^ (RootCode << (2 * depth));
+        auto x = static_cast<std::int64_t>(detail::compactBits(morton));
+        auto y = static_cast<std::int64_t>(detail::compactBits(morton >> 1));
+        // Leaves larger than the cell may be adjacent through several directions
+        auto largerNeighbours = std::array<LocationalCode, 8>();
+        auto nbLargerNeighbours = std::size_t(0);
+        for (auto dy = -1; dy <= 1; ++dy)
+        {
+            for (auto dx = -1; dx <= 1; ++dx)
+            {
+                auto nx = x + dx;
+                auto ny = y + dy;
+                if ((dx == 0 && dy == 0) || nx < 0 || nx >= nbCells || ny < 0 || ny >= nbCells)
+                    continue;
+                auto neighbourCode = (RootCode << (2 * depth)) |
+                    detail::interleaveBits(static_cast<std::uint32_t>(nx), static_cast<std::uint32_t>(ny));
+                auto location = findDeepestNode(neighbourCode);
+                if (location.code != neighbourCode)
+                {
+                    auto end = std::begin(largerNeighbours) + static_cast<std::ptrdiff_t>(nbLargerNeighbours);
+                    if (std::find(std::begin(largerNeighbours), end, location.code) == end)
+                    {
+                        largerNeighbours[nbLargerNeighbours++] = location.code;
+                        f(location.code, location.box, location.node->values);
+                    }
+                }
+                // Only the leaves on the side facing the cell are adjacent
+                else
+                    forEachLeafOnSide(location.node, location.code, location.box, -dx, -dy, f);
+            }
+        }
+    }
+
 private:
-    static constexpr auto Threshold = std::size_t(16);
-    static constexpr auto MaxDepth = std::size_t(8);
+    static constexpr auto IsRecording = !std::is_same<Recorder, detail::NoRecorder>::value;
+    static constexpr auto RootCode = LocationalCode(1);
+    static constexpr auto MaxRejectionsPerSample = std::size_t(16);
+    static constexpr auto TasksPerThread = std::size_t(4);
+    static constexpr auto ValuesPerIntersectionTask = std::size_t(16);
+
+    static_assert(Threshold > 0, "Threshold must be positive");
+    static_assert(MaxDepth <= 31, "Locational codes must fit in 64 bits");
+
+    // Leaves at the maximum depth that overflow index their values with a grid
+    using LeafGrid = detail::CellIndex<Float, Allocator>;
 
     struct Node;
 #if __cplusplus < 201703L
@@ -114,22 +783,614 @@ private:
 #else
     typedef std::invoke_result_t<MakeUnique<Node>> UniqueNodePtr;
 #endif
+    using HasLeafGrids = std::integral_constant<bool, (LeafGridResolution > 0)>;
+    using UniqueGridPtr = typename detail::GridPointer<LeafGrid, MakeUnique, Float, HasLeafGrids::value>::type;
 
     struct Node
     {
         std::array<UniqueNodePtr, 4> children;
         vector_type<T> values;
+        UniqueGridPtr grid;
+        // Number of values in the subtree and union of their boxes, the union is
+        // only recomputed by queryLod once a value on its border moved or left.
+        // The modifications write staleBounds relaxed as they run alone, queryLod
+        // publishes the recomputed bounds by clearing it with release semantics.
+        std::size_t count = 0;
+        mutable Box<Float> bounds;
+        mutable std::atomic<bool> staleBounds{false};
+    };
+
+    // Fully covered subtrees and values of the nodes on the border of a sampled box
+    struct SamplerItem
+    {
+        const Node* node;
+        bool covered;
+    };
+
+    struct Sampler
+    {
+        vector_type<SamplerItem> items;
+        vector_type<std::size_t> ends; // Cumulative weights of the items
+        vector_type<const T*> filtered; // Values of the border that intersect the box
+        std::size_t total = 0;
+    };
+
+    struct NodeLocation
+    {
+        Node* node;
+        LocationalCode code;
+        Box<Float> box;
+    };
+
+    // Node in the order of compact with the position of its parent in this order
+    struct OrderedNode
+    {
+        const Node* node;
+        std::size_t parent;
+        std::size_t child;
+    };
+
+    // Subtree to build with its values in the order they were added
+    struct BuildItem
+    {
+        Node* node;
+        std::size_t depth;
+        Box<Float> box;
+        vector_type<T> values;
     };
 
+    // Policies and share of the spare nodes of a task of build
+    struct BuildTask
+    {
+        MakeUnique<Node> makeUnique;
+        MakeUnique<LeafGrid> makeGrid;
+        vector_type<UniqueNodePtr> spareNodes;
+    };
+
+    // Part of the serial traversal of findAllIntersections
+    struct IntersectionTask
+    {
+        enum class Type
+        {
+            Subtree, // All the intersections in the subtree of node
+            Node, // Intersections between the values of node
+            Child // Intersections between node->values[begin:end) and the subtree of the child
+        };
+
+        Type type;
+        Node* node;
+        std::size_t child;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    using HashTable = std::unordered_map<LocationalCode, Node*, std::hash<LocationalCode>,
+        std::equal_to<LocationalCode>, Allocator<std::pair<const LocationalCode, Node*>>>;
+
     Box<Float> mBox;
     MakeUnique<Node> mMakeUnique;
+    MakeUnique<LeafGrid> mMakeGrid;
     UniqueNodePtr mRoot;
     GetBox mGetBox;
     Equal mEqual;
+    bool mHashing = false;
+    mutable Recorder mRecorder;
+    HashTable mNodes;
+    MaintenancePolicy mMaintenance;
+    vector_type<LocationalCode> mPendingCollapses;
+    std::size_t mNbReservedNodes = 0;
+    vector_type<UniqueNodePtr> mSpareNodes; // Nodes to reuse in the splits
+    mutable detail::QuadtreeMutex mBoundsMutex; // Recomputation of the stale bounds
+
+    bool isLeaf(const Node* node) const
+    {
+        return !static_cast<bool>(node->children[0]);
+    }
+
+    static std::size_t getDepth(LocationalCode code)
+    {
+        auto depth = std::size_t(0);
+        for (; code > RootCode; code >>= 2)
+            ++depth;
+        return depth;
+    }
+
+    // Code of the node of depth depth containing the cell (x, y) of the finest level
+    static LocationalCode getCode(std::uint32_t x, std::uint32_t y, std::size_t depth)
+    {
+        auto shift = MaxDepth - depth;
+        return (RootCode << (2 * depth)) | detail::interleaveBits(x >> shift, y >> shift);
+    }
+
+    static std::uint32_t getCellCoordinate(Float x, Float origin, Float size)
+    {
+        constexpr auto nbCells = std::uint32_t(1) << MaxDepth;
+        auto i = std::floor((x - origin) / size * static_cast<Float>(nbCells));
+        if (!(i > 0))
+            return 0;
+        else if (i >= static_cast<Float>(nbCells - 1))
+            return nbCells - 1;
+        else
+            return static_cast<std::uint32_t>(i);
+    }
+
+    Box<Float> computeBox(LocationalCode code) const
+    {
+        auto box = mBox;
+        for (auto depth = getDepth(code); depth > 0; --depth)
+            box = computeBox(box, static_cast<int>((code >> (2 * (depth - 1))) & 3));
+        return box;
+    }
+
+    // Find the deepest node on the path to the node of code
+    NodeLocation findDeepestNode(LocationalCode code) const
+    {
+        auto depth = getDepth(code);
+        if (mHashing)
+        {
+            auto minDepth = std::size_t(0);
+            auto maxDepth = depth;
+            auto deepestNode = mRoot.get();
+            while (minDepth < maxDepth)
+            {
+                auto middle = (minDepth + maxDepth + 1) / 2;
+                auto node = findNode(code >> (2 * (depth - middle)));
+                if (node != nullptr)
+                {
+                    minDepth = middle;
+                    deepestNode = node;
+                }
+                else
+                    maxDepth = middle - 1;
+            }
+            auto deepestCode = code >> (2 * (depth - minDepth));
+            return NodeLocation{deepestNode, deepestCode, computeBox(deepestCode)};
+        }
+        auto location = NodeLocation{mRoot.get(), RootCode, mBox};
+        for (; depth > 0 && !isLeaf(location.node); --depth)
+        {
+            auto i = (code >> (2 * (depth - 1))) & 3;
+            location.node = location.node->children[i].get();
+            location.code = location.code * 4 + i;
+            location.box = computeBox(location.box, static_cast<int>(i));
+        }
+        return location;
+    }
+
+    template <typename F>
+    void queryLod(const Node* node, std::size_t depth, const Box<Float>& box, const Box<Float>& queryBox,
+        std::size_t maxDepth, F& f) const
+    {
+        if (node->count == 0)
+            return;
+        if (depth >= maxDepth || isLeaf(node))
+        {
+            f(NodeSummary{box, getBounds(node), node->count, findRepresentative(node), depth});
+            return;
+        }
+        // Summary of the values of this node only
+        if (!node->values.empty())
+        {
+            auto bounds = mGetBox(node->values.front());
+            for (const auto& value : node->values)
+                bounds = computeUnion(bounds, mGetBox(value));
+            f(NodeSummary{box, bounds, node->values.size(), &node->values.front(), depth});
+        }
+        for (auto i = std::size_t(0); i < node->children.size(); ++i)
+        {
+            auto childBox = computeBox(box, static_cast<int>(i));
+            if (queryBox.intersects(childBox))
+                queryLod(node->children[i].get(), depth + 1, childBox, queryBox, maxDepth, f);
+        }
+    }
+
+    void prepareSampler(const Node* node, const Box<Float>& box, const Box<Float>& sampleBox, bool covered,
+        Sampler& sampler) const
+    {
+        if (node->count == 0)
+            return;
+        covered = covered || sampleBox.contains(box);
+        auto weight = covered ? node->count : node->values.size();
+        if (weight > 0)
+        {
+            sampler.total += weight;
+            sampler.items.push_back(SamplerItem{node, covered});
+            sampler.ends.push_back(sampler.total);
+        }
+        if (!covered && !isLeaf(node))
+        {
+            for (auto i = std::size_t(0); i < node->children.size(); ++i)
+            {
+                auto childBox = computeBox(box, static_cast<int>(i));
+                if (sampleBox.intersects(childBox))
+                    prepareSampler(node->children[i].get(), childBox, sampleBox, false, sampler);
+            }
+        }
+    }
+
+    void filterSampler(const Box<Float>& sampleBox, Sampler& sampler) const
+    {
+        auto items = vector_type<SamplerItem>();
+        sampler.ends.clear();
+        sampler.total = 0;
+        for (const auto& item : sampler.items)
+        {
+            if (item.covered)
+            {
+                sampler.total += item.node->count;
+                items.push_back(item);
+                sampler.ends.push_back(sampler.total);
+            }
+            else
+            {
+                for (const auto& value : item.node->values)
+                {
+                    if (sampleBox.intersects(mGetBox(value)))
+                        sampler.filtered.push_back(&value);
+                }
+            }
+        }
+        if (!sampler.filtered.empty())
+        {
+            sampler.total += sampler.filtered.size();
+            items.push_back(SamplerItem{nullptr, false});
+            sampler.ends.push_back(sampler.total);
+        }
+        sampler.items = std::move(items);
+    }
+
+    // Return the value of rank r in the subtree
+    const T& drawValue(const Node* node, std::size_t r) const
+    {
+        while (r >= node->values.size())
+        {
+            assert(!isLeaf(node) && r < node->count && "Invalid rank");
+            r -= node->values.size();
+            for (const auto& child : node->children)
+            {
+                if (r < child->count)
+                {
+                    node = child.get();
+                    break;
+                }
+                r -= child->count;
+            }
+        }
+        return node->values[r];
+    }
+
+    const T* findRepresentative(const Node* node) const
+    {
+        while (node->values.empty())
+        {
+            assert(!isLeaf(node) && "The subtree must not be empty");
+            node = std::find_if(std::begin(node->children), std::end(node->children),
+                [](const auto& child){ return child->count > 0; })->get();
+        }
+        return &node->values.front();
+    }
+
+    template <typename F>
+    void forEachLeaf(const Node* node, LocationalCode code, const Box<Float>& box, F& f) const
+    {
+        if (isLeaf(node))
+            f(code, box, node->values);
+        else
+        {
+            for (auto i = std::size_t(0); i < node->children.size(); ++i)
+                forEachLeaf(node->children[i].get(), code * 4 + i, computeBox(box, static_cast<int>(i)), f);
+        }
+    }
+
+    template <typename F>
+    void forEachNode(const Node* node, LocationalCode code, const Box<Float>& box, F& f) const
+    {
+        f(code, box, node->values, isLeaf(node));
+        if (!isLeaf(node))
+        {
+            for (auto i = std::size_t(0); i < node->children.size(); ++i)
+                forEachNode(node->children[i].get(), code * 4 + i, computeBox(box, static_cast<int>(i)), f);
+        }
+    }
+
+    // Visit the leaves touching the side (sx, sy) of the node, -1 for west or
+    // north, 1 for east or south and 0 for any
+    template <typename F>
+    void forEachLeafOnSide(const Node* node, LocationalCode code, const Box<Float>& box, int sx, int sy, F& f) const
+    {
+        if (isLeaf(node))
+            f(code, box, node->values);
+        else
+        {
+            for (auto i = std::size_t(0); i < node->children.size(); ++i)
+            {
+                auto east = (i & 1) != 0;
+                auto south = (i & 2) != 0;
+                if ((sx == 0 || east == (sx > 0)) && (sy == 0 || south == (sy > 0)))
+                    forEachLeafOnSide(node->children[i].get(), code * 4 + i, computeBox(box, static_cast<int>(i)), sx, sy, f);
+            }
+        }
+    }
+
+    void memoryUsage(const Node* node, MemoryUsage& usage) const
+    {
+        usage.nodes += sizeof(Node);
+        usage.values += node->values.size() * sizeof(T);
+        usage.slack += (node->values.capacity() - node->values.size()) * sizeof(T);
+        if (node->grid)
+        {
+            usage.indexes += sizeof(LeafGrid);
+            usage += node->grid->memoryUsage();
+        }
+        if (!isLeaf(node))
+        {
+            for (const auto& child : node->children)
+                memoryUsage(child.get(), usage);
+        }
+    }
+
+    std::size_t getHeight(const Node* node) const
+    {
+        auto height = std::size_t(0);
+        if (!isLeaf(node))
+        {
+            for (const auto& child : node->children)
+                height = std::max(height, getHeight(child.get()));
+        }
+        return height + 1;
+    }
+
+    // Add the nodes of the height first levels of the subtree in van Emde Boas order,
+    // and the positions of the ones on the last of these levels to frontier
+    void addVanEmdeBoasOrder(const Node* node, std::size_t parent, std::size_t child, std::size_t height,
+        vector_type<OrderedNode>& nodes, vector_type<std::size_t>& frontier) const
+    {
+        if (height == 1)
+        {
+            frontier.push_back(nodes.size());
+            nodes.push_back(OrderedNode{node, parent, child});
+            return;
+        }
+        auto bottomHeight = height / 2;
+        auto topHeight = height - bottomHeight;
+        auto topFrontier = vector_type<std::size_t>();
+        addVanEmdeBoasOrder(node, parent, child, topHeight, nodes, topFrontier);
+        for (auto i : topFrontier)
+        {
+            auto bottomParent = nodes[i].node;
+            if (!isLeaf(bottomParent))
+            {
+                for (auto j = std::size_t(0); j < bottomParent->children.size(); ++j)
+                    addVanEmdeBoasOrder(bottomParent->children[j].get(), i, j, bottomHeight, nodes, frontier);
+            }
+        }
+    }
+
+    // New node without children with the values of node, shrunk to fit, and its grid rebuilt
+    UniqueNodePtr copyNode(const Node* node, MakeUnique<Node>& makeUnique, MakeUnique<LeafGrid>& makeGrid)
+    {
+        auto newNode = makeUnique();
+        newNode->values.reserve(node->values.size());
+        newNode->values.insert(std::end(newNode->values), std::begin(node->values), std::end(node->values));
+        newNode->count = node->count;
+        newNode->bounds = node->bounds;
+        newNode->staleBounds.store(node->staleBounds.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        if (node->grid)
+        {
+            newNode->grid = createGrid(makeGrid, node->grid->area(), HasLeafGrids());
+            for (auto i = std::size_t(0); i < newNode->values.size(); ++i)
+                newNode->grid->insert(i, mGetBox(newNode->values[i]));
+        }
+        return newNode;
+    }
+
+    void addToHashTable(Node* node, LocationalCode code)
+    {
+        mNodes[code] = node;
+        if (!isLeaf(node))
+        {
+            for (auto i = std::size_t(0); i < node->children.size(); ++i)
+                addToHashTable(node->children[i].get(), code * 4 + i);
+        }
+    }
+
+    // Node of code found from the root, nullptr if the path stops at a leaf before
+    Node* descend(LocationalCode code) const
+    {
+        auto node = mRoot.get();
+        for (auto depth = getDepth(code); depth > 0; --depth)
+        {
+            if (isLeaf(node))
+                return nullptr;
+            node = node->children[(code >> (2 * (depth - 1))) & 3].get();
+        }
+        return node;
+    }
+
+    void addPendingCollapses(const Node* node, LocationalCode code)
+    {
+        if (isLeaf(node))
+            return;
+        // The descendants are collapsed with the node
+        if (node->count <= mMaintenance.collapseThreshold)
+            mPendingCollapses.push_back(code);
+        else
+        {
+            for (auto i = std::size_t(0); i < node->children.size(); ++i)
+                addPendingCollapses(node->children[i].get(), code * 4 + i);
+        }
+    }
+
+    UniqueNodePtr createNode()
+    {
+        if (mSpareNodes.empty())
+            return mMakeUnique();
+        auto node = std::move(mSpareNodes.back());
+        mSpareNodes.pop_back();
+        return node;
+    }
+
+    // Keep the nodes of the subtree for the next splits while there is room in the reserve
+    void releaseNode(UniqueNodePtr& node)
+    {
+        if (!isLeaf(node.get()))
+        {
+            for (auto& child : node->children)
+                releaseNode(child);
+        }
+        if (mSpareNodes.size() < mNbReservedNodes)
+        {
+            // The large buffers of the leaves at the maximum depth are not kept
+            if (node->values.capacity() > Threshold)
+            {
+                node->values = vector_type<T>();
+                node->values.reserve(Threshold);
+            }
+            node->values.clear();
+            node->grid.reset();
+            node->count = 0;
+            node->bounds = Box<Float>();
+            node->staleBounds.store(false, std::memory_order_relaxed);
+            mSpareNodes.push_back(std::move(node));
+        }
+        else
+            node.reset();
+    }
+
+    std::size_t getNbNodes(const Node* node) const
+    {
+        auto nbNodes = std::size_t(1);
+        if (!isLeaf(node))
+        {
+            for (const auto& child : node->children)
+                nbNodes += getNbNodes(child.get());
+        }
+        return nbNodes;
+    }
+
+    void shrinkToFit(Node* node)
+    {
+        node->values.shrink_to_fit();
+        if (node->grid)
+            node->grid->shrinkToFit();
+        if (!isLeaf(node))
+        {
+            for (const auto& child : node->children)
+                shrinkToFit(child.get());
+        }
+    }
+
+    // Move all the values of the subtree into node, which becomes a leaf
+    void collapse(Node* node, LocationalCode code)
+    {
+        node->values.reserve(node->count);
+        for (auto i = std::size_t(0); i < node->children.size(); ++i)
+            collapseChild(node, node->children[i].get(), code * 4 + i);
+        for (auto& child : node->children)
+            releaseNode(child);
+    }
+
+    void collapseChild(Node* node, const Node* child, LocationalCode code)
+    {
+        node->values.insert(std::end(node->values), std::begin(child->values), std::end(child->values));
+        if (mHashing)
+            mNodes.erase(code);
+        if (!isLeaf(child))
+        {
+            for (auto i = std::size_t(0); i < child->children.size(); ++i)
+                collapseChild(node, child->children[i].get(), code * 4 + i);
+        }
+    }
+
+    void computeHealth(const Node* node, std::size_t depth, Health& health) const
+    {
+        ++health.nbNodes;
+        health.maxDepth = std::max(health.maxDepth, depth);
+        if (isLeaf(node))
+        {
+            ++health.nbLeaves;
+            if (node->values.empty())
+                ++health.nbEmptyLeaves;
+            if (depth >= MaxDepth && node->values.size() > Threshold && !node->grid)
+                ++health.nbOverflowingLeaves;
+        }
+        else
+        {
+            health.nbStraddlers += node->values.size();
+            if (node->count <= Threshold)
+                ++health.nbUnderfullNodes;
+            for (const auto& child : node->children)
+                computeHealth(child.get(), depth + 1, health);
+        }
+    }
+
+    Node* findNode(LocationalCode code) const
+    {
+        auto it = mNodes.find(code);
+        return it != std::end(mNodes) ? it->second : nullptr;
+    }
+
+    // Find the node where a value with this box is stored, or would be stored
+    NodeLocation locateNode(const Box<Float>& valueBox) const
+    {
+        if (mHashing)
+        {
+            // The node is on the path of the cells of the corners, as deep as
+            // both corners are in the same cell
+            auto left = getCellCoordinate(valueBox.left, mBox.left, mBox.width);
+            auto top = getCellCoordinate(valueBox.top, mBox.top, mBox.height);
+            auto right = getCellCoordinate(valueBox.getRight(), mBox.left, mBox.width);
+            auto bottom = getCellCoordinate(valueBox.getBottom(), mBox.top, mBox.height);
+            auto maxDepth = MaxDepth;
+            while (maxDepth > 0 && getCode(left, top, maxDepth) != getCode(right, bottom, maxDepth))
+                --maxDepth;
+            // Binary search of the deepest node on this path
+            auto minDepth = std::size_t(0);
+            auto deepestNode = mRoot.get();
+            while (minDepth < maxDepth)
+            {
+                auto depth = (minDepth + maxDepth + 1) / 2;
+                auto node = findNode(getCode(left, top, depth));
+                if (node != nullptr)
+                {
+                    minDepth = depth;
+                    deepestNode = node;
+                }
+                else
+                    maxDepth = depth - 1;
+            }
+            auto location = NodeLocation{deepestNode, getCode(left, top, minDepth), Box<Float>()};
+            // Rounding errors may make the cells disagree with the boxes of the nodes
+            if (isLocationOf(location, valueBox))
+                return location;
+        }
+        auto location = NodeLocation{mRoot.get(), RootCode, mBox};
+        while (!isLeaf(location.node))
+        {
+            auto i = getQuadrant(location.box, valueBox);
+            if (i == -1)
+                break;
+            location.node = location.node->children[static_cast<std::size_t>(i)].get();
+            location.code = location.code * 4 + static_cast<std::size_t>(i);
+            location.box = computeBox(location.box, i);
+        }
+        return location;
+    }
 
-    bool isLeaf(const Node* node) const
+    // Check that a value with this box is stored in the node at location and compute its box
+    bool isLocationOf(NodeLocation& location, const Box<Float>& valueBox) const
     {
-        return !static_cast<bool>(node->children[0]);
+        assert(location.node != nullptr);
+        auto box = mBox;
+        for (auto depth = getDepth(location.code); depth > 0; --depth)
+        {
+            auto i = getQuadrant(box, valueBox);
+            if (i == -1 || static_cast<LocationalCode>(i) != ((location.code >> (2 * (depth - 1))) & 3))
+                return false;
+            box = computeBox(box, i);
+        }
+        location.box = box;
+        return isLeaf(location.node) || getQuadrant(box, valueBox) == -1;
     }
 
     Box<Float> computeBox(const Box<Float>& box, int i) const
@@ -190,80 +1451,234 @@ private:
             return -1;
     }
 
-    void add(Node* node, std::size_t depth, const Box<Float>& box, const T& value)
+    void add(Node* node, LocationalCode code, std::size_t depth, const Box<Float>& box, const T& value)
     {
         assert(node != nullptr);
         assert(box.contains(mGetBox(value)));
         if (isLeaf(node))
         {
             // Insert the value in this node if possible
-            if (depth >= MaxDepth || node->values.size() < Threshold)
+            if (depth >= MaxDepth)
+            {
+                addToSummary(node, mGetBox(value));
+                addValueAtMaxDepth(node, box, value, mMakeGrid);
+            }
+            else if (node->values.size() < Threshold)
+            {
+                addToSummary(node, mGetBox(value));
                 node->values.push_back(value);
+            }
             // Otherwise, we split and we try again
             else
             {
-                split(node, box);
-                add(node, depth, box, value);
+                split(node, code, box);
+                add(node, code, depth, box, value);
             }
         }
         else
         {
-            auto i = getQuadrant(box, mGetBox(value));
+            auto valueBox = mGetBox(value);
+            addToSummary(node, valueBox);
+            auto i = getQuadrant(box, valueBox);
             // Add the value in a child if the value is entirely contained in it
             if (i != -1)
-                add(node->children[static_cast<std::size_t>(i)].get(), depth + 1, computeBox(box, i), value);
+                add(node->children[static_cast<std::size_t>(i)].get(), code * 4 + static_cast<std::size_t>(i),
+                    depth + 1, computeBox(box, i), value);
             // Otherwise, we add the value in the current node
             else
                 node->values.push_back(value);
         }
     }
 
-    void split(Node* node, const Box<Float>& box)
+    void addValueAtMaxDepth(Node* node, const Box<Float>& box, const T& value, MakeUnique<LeafGrid>& makeGrid)
+    {
+        node->values.push_back(value);
+        if (node->grid)
+            node->grid->insert(node->values.size() - 1, mGetBox(value));
+        // The leaf cannot be split anymore, index its values with a grid instead
+        else if (HasLeafGrids::value && node->values.size() > Threshold)
+        {
+            node->grid = createGrid(makeGrid, box, HasLeafGrids());
+            for (auto i = std::size_t(0); i < node->values.size(); ++i)
+                node->grid->insert(i, mGetBox(node->values[i]));
+        }
+    }
+
+    static UniqueGridPtr createGrid(MakeUnique<LeafGrid>& makeGrid, const Box<Float>& box, std::true_type)
+    {
+        return makeGrid(box, LeafGridResolution, LeafGridResolution);
+    }
+
+    // Never called, the grid code is not instantiated without grids
+    static UniqueGridPtr createGrid(MakeUnique<LeafGrid>&, const Box<Float>&, std::false_type)
+    {
+        return UniqueGridPtr();
+    }
+
+    void split(Node* node, LocationalCode code, const Box<Float>& box)
     {
         assert(node != nullptr);
         assert(isLeaf(node) && "Only leaves can be split");
         // Create children
         for (auto& child : node->children)
-            child = mMakeUnique();
-        // Assign values to children
-        auto newValues = vector_type<T>(); // New values for this node
-        for (const auto& value : node->values)
+            child = createNode();
+        if (mHashing)
         {
-            auto i = getQuadrant(box, mGetBox(value));
+            for (auto i = std::size_t(0); i < node->children.size(); ++i)
+                mNodes[code * 4 + i] = node->children[i].get();
+        }
+        // Assign values to children, the others stay in place in this node
+        auto& values = node->values;
+        auto nbStraddlers = std::size_t(0);
+        for (auto j = std::size_t(0); j < values.size(); ++j)
+        {
+            auto valueBox = mGetBox(values[j]);
+            auto i = getQuadrant(box, valueBox);
             if (i != -1)
-                node->children[static_cast<std::size_t>(i)]->values.push_back(value);
+            {
+                auto& child = node->children[static_cast<std::size_t>(i)];
+                addToSummary(child.get(), valueBox);
+                child->values.push_back(std::move(values[j]));
+            }
             else
-                newValues.push_back(value);
+            {
+                if (nbStraddlers != j)
+                    values[nbStraddlers] = std::move(values[j]);
+                ++nbStraddlers;
+            }
         }
-        node->values = std::move(newValues);
+        values.erase(std::begin(values) + static_cast<std::ptrdiff_t>(nbStraddlers), std::end(values));
     }
 
-    void remove(Node* node, Node* parent, const Box<Float>& box, const T& value)
+    void remove(Node* node, Node* parent, LocationalCode code, const Box<Float>& box, const T& value,
+        const Box<Float>& valueBox)
     {
         assert(node != nullptr);
-        assert(box.contains(mGetBox(value)));
+        assert(box.contains(valueBox));
         if (isLeaf(node))
         {
             // Remove the value from node
-            removeValue(node, value);
+            removeValue(node, value, valueBox);
+            removeFromSummary(node, valueBox);
             // Try to merge the parent
             if (parent != nullptr)
-                tryMerge(parent);
+                tryMerge(parent, code >> 2);
         }
         else
         {
             // Remove the value in a child if the value is entirely contained in it
-            auto i = getQuadrant(box, mGetBox(value));
+            auto i = getQuadrant(box, valueBox);
             if (i != -1)
-                remove(node->children[static_cast<std::size_t>(i)].get(), node, computeBox(box, i), value);
+                remove(node->children[static_cast<std::size_t>(i)].get(), node, code * 4 + static_cast<std::size_t>(i),
+                    computeBox(box, i), value, valueBox);
             // Otherwise, we remove the value from the current node
             else
-                removeValue(node, value);
+                removeValue(node, value, valueBox);
+            // The children may have been merged, it is handled by removeFromSummary
+            removeFromSummary(node, valueBox);
+            if (mMaintenance.enabled && !isLeaf(node) && node->count == mMaintenance.collapseThreshold)
+                mPendingCollapses.push_back(code);
+        }
+    }
+
+    static Box<Float> computeUnion(const Box<Float>& a, const Box<Float>& b)
+    {
+        auto left = std::min(a.left, b.left);
+        auto top = std::min(a.top, b.top);
+        return Box<Float>(left, top, std::max(a.getRight(), b.getRight()) - left,
+            std::max(a.getBottom(), b.getBottom()) - top);
+    }
+
+    // A value on the border of the bounds may have been the one defining them
+    static bool isOnBorder(const Box<Float>& bounds, const Box<Float>& box)
+    {
+        return box.left <= bounds.left || box.top <= bounds.top ||
+            box.getRight() >= bounds.getRight() || box.getBottom() >= bounds.getBottom();
+    }
+
+    void addToSummary(Node* node, const Box<Float>& valueBox)
+    {
+        if (node->count == 0)
+        {
+            node->bounds = valueBox;
+            node->staleBounds.store(false, std::memory_order_relaxed);
+        }
+        else if (!node->staleBounds.load(std::memory_order_relaxed))
+            node->bounds = computeUnion(node->bounds, valueBox);
+        ++node->count;
+    }
+
+    void removeFromSummary(Node* node, const Box<Float>& valueBox)
+    {
+        assert(node->count > 0);
+        --node->count;
+        if (!node->staleBounds.load(std::memory_order_relaxed) && isOnBorder(node->bounds, valueBox))
+            node->staleBounds.store(true, std::memory_order_relaxed);
+    }
+
+    // Return whether the bounds may have changed. Otherwise the bounds of the ancestors
+    // do not change either: they contain these bounds, so newBox, and oldBox is inside them.
+    bool moveInSummary(Node* node, const Box<Float>& oldBox, const Box<Float>& newBox)
+    {
+        if (node->staleBounds.load(std::memory_order_relaxed))
+            return true;
+        if (isOnBorder(node->bounds, oldBox))
+        {
+            node->staleBounds.store(true, std::memory_order_relaxed);
+            return true;
+        }
+        if (node->bounds.contains(newBox))
+            return false;
+        node->bounds = computeUnion(node->bounds, newBox);
+        return true;
+    }
+
+    // The bounds that are not stale are exact and never written by queryLod, the stale
+    // ones are recomputed by a single thread at a time
+    const Box<Float>& getBounds(const Node* node) const
+    {
+        if (node->staleBounds.load(std::memory_order_acquire))
+        {
+            auto lock = std::unique_lock<std::mutex>(mBoundsMutex);
+            recomputeBounds(node);
+        }
+        return node->bounds;
+    }
+
+    // Recompute the stale bounds from the values of the node and the bounds of its
+    // children, mBoundsMutex must be locked
+    const Box<Float>& recomputeBounds(const Node* node) const
+    {
+        if (node->staleBounds.load(std::memory_order_relaxed))
+        {
+            auto count = std::size_t(0);
+            for (const auto& value : node->values)
+            {
+                auto valueBox = mGetBox(value);
+                node->bounds = count++ > 0 ? computeUnion(node->bounds, valueBox) : valueBox;
+            }
+            if (!isLeaf(node))
+            {
+                for (const auto& child : node->children)
+                {
+                    if (child->count == 0)
+                        continue;
+                    const auto& childBounds = recomputeBounds(child.get());
+                    node->bounds = count++ > 0 ? computeUnion(node->bounds, childBounds) : childBounds;
+                }
+            }
+            node->staleBounds.store(false, std::memory_order_release);
         }
+        return node->bounds;
     }
 
-    void removeValue(Node* node, const T& value)
+    void removeValue(Node* node, const T& value, const Box<Float>& valueBox)
     {
+        if (node->grid)
+        {
+            removeValueFromGrid(node, value, valueBox);
+            return;
+        }
         // Find the value in node->values
         auto it = std::find_if(std::begin(node->values), std::end(node->values),
             [this, &value](const auto& rhs){ return mEqual(value, rhs); });
@@ -273,7 +1688,74 @@ private:
         node->values.pop_back();
     }
 
-    void tryMerge(Node* node)
+    void removeValueFromGrid(Node* node, const T& value, const Box<Float>& valueBox)
+    {
+        auto& values = node->values;
+        auto i = findInGrid(node, value, valueBox);
+        assert(i != LeafGrid::npos && "Trying to remove a value that is not present in the node");
+        node->grid->erase(i, valueBox);
+        // Swap with the last element and pop back
+        auto last = values.size() - 1;
+        if (i != last)
+        {
+            node->grid->reindex(last, i, mGetBox(values[last]));
+            values[i] = std::move(values[last]);
+        }
+        values.pop_back();
+        // Go back to a plain leaf when there are few values left
+        if (values.size() <= Threshold / 2)
+            node->grid.reset();
+    }
+
+    std::size_t findInGrid(const Node* node, const T& value, const Box<Float>& valueBox) const
+    {
+        const auto& values = node->values;
+        return node->grid->find(valueBox, [this, &values, &value](std::size_t index){ return mEqual(value, values[index]); });
+    }
+
+    // Return whether the bounds of the ancestors may change
+    bool update(Node* node, LocationalCode code, std::size_t depth, const Box<Float>& box, const T& value,
+        const Box<Float>& oldBox, const Box<Float>& newBox)
+    {
+        assert(node != nullptr);
+        if (isLeaf(node))
+        {
+            updateValue(node, value, oldBox, newBox);
+            return moveInSummary(node, oldBox, newBox);
+        }
+        auto i = getQuadrant(box, oldBox);
+        auto j = getQuadrant(box, newBox);
+        // The value stays in this node
+        if (i == -1 && j == -1)
+            return moveInSummary(node, oldBox, newBox);
+        // The value stays in the same child
+        else if (i == j)
+        {
+            return update(node->children[static_cast<std::size_t>(i)].get(), code * 4 + static_cast<std::size_t>(i),
+                depth + 1, computeBox(box, i), value, oldBox, newBox) && moveInSummary(node, oldBox, newBox);
+        }
+        // The paths diverge here, move the value
+        else
+        {
+            remove(node, nullptr, code, box, value, oldBox);
+            add(node, code, depth, box, value);
+            return true;
+        }
+    }
+
+    // Update the value in place, only the leaf grids store the boxes
+    void updateValue(Node* node, const T& value, const Box<Float>& oldBox, const Box<Float>& newBox)
+    {
+        if (node->grid)
+        {
+            auto i = findInGrid(node, value, oldBox);
+            assert(i != LeafGrid::npos && "Trying to update a value that is not present in the node");
+            node->grid->erase(i, oldBox);
+            node->grid->insert(i, newBox);
+        }
+    }
+
+    void tryMerge(Node* node, LocationalCode code)
     {
         assert(node != nullptr);
         assert(!isLeaf(node) && "Only interior nodes can be merged");
@@ -295,7 +1777,12 @@ private:
             }
             // Remove the children
             for (auto& child : node->children)
-                child.reset();
+                releaseNode(child);
+            if (mHashing)
+            {
+                for (auto i = std::size_t(0); i < node->children.size(); ++i)
+                    mNodes.erase(code * 4 + i);
+            }
         }
     }
 
@@ -303,11 +1790,7 @@ private:
     {
         assert(node != nullptr);
         assert(queryBox.intersects(box));
-        for (const auto& value : node->values)
-        {
-            if (queryBox.intersects(mGetBox(value)))
-                values.push_back(value);
-        }
+        queryValues(node, queryBox, values);
         if (!isLeaf(node))
         {
             for (auto i = std::size_t(0); i < node->children.size(); ++i)
@@ -319,18 +1802,24 @@ private:
         }
     }
 
-    void findAllIntersections(Node* node, vector_type<std::pair<T, T>>& intersections) const
+    // Values of node intersecting queryBox
+    void queryValues(const Node* node, const Box<Float>& queryBox, vector_type<T>& values) const
     {
-        // Find intersections between values stored in this node
-        // Make sure to not report the same intersection twice
-        for (auto i = std::size_t(0); i < node->values.size(); ++i)
+        if (node->grid)
+            node->grid->query(queryBox, [node, &values](std::size_t i){ values.push_back(node->values[i]); });
+        else
         {
-            for (auto j = std::size_t(0); j < i; ++j)
+            for (const auto& value : node->values)
             {
-                if (mGetBox(node->values[i]).intersects(mGetBox(node->values[j])))
-                    intersections.emplace_back(node->values[i], node->values[j]);
+                if (queryBox.intersects(mGetBox(value)))
+                    values.push_back(value);
             }
         }
+    }
+
+    void findAllIntersections(Node* node, vector_type<std::pair<T, T>>& intersections) const
+    {
+        findIntersectionsInNode(node, intersections);
         if (!isLeaf(node))
         {
             // Values in this node can intersect values in descendants
@@ -345,14 +1834,51 @@ private:
         }
     }
 
-    void findIntersectionsInDescendants(Node* node, const T& value, vector_type<std::pair<T, T>>& intersections) const
+    // Intersections between the values stored in node
+    void findIntersectionsInNode(const Node* node, vector_type<std::pair<T, T>>& intersections) const
+    {
+        if (node->grid)
+        {
+            node->grid->findAllIntersections([node, &intersections](std::size_t i, std::size_t j)
+            {
+                intersections.emplace_back(node->values[i], node->values[j]);
+            });
+            return;
+        }
+        // Make sure to not report the same intersection twice
+        for (auto i = std::size_t(0); i < node->values.size(); ++i)
+        {
+            for (auto j = std::size_t(0); j < i; ++j)
+            {
+                if (mGetBox(node->values[i]).intersects(mGetBox(node->values[j])))
+                    intersections.emplace_back(node->values[i], node->values[j]);
+            }
+        }
+    }
+
+    // Intersections between value and the values stored in node
+    void findIntersectionsWithValue(const Node* node, const T& value, vector_type<std::pair<T, T>>& intersections) const
     {
-        // Test against the values stored in this node
-        for (const auto& other : node->values)
+        if (node->grid)
+        {
+            node->grid->query(mGetBox(value), [node, &value, &intersections](std::size_t i)
+            {
+                intersections.emplace_back(value, node->values[i]);
+            });
+        }
+        else
         {
-            if (mGetBox(value).intersects(mGetBox(other)))
-                intersections.emplace_back(value, other);
+            for (const auto& other : node->values)
+            {
+                if (mGetBox(value).intersects(mGetBox(other)))
+                    intersections.emplace_back(value, other);
+            }
         }
+    }
+
+    void findIntersectionsInDescendants(Node* node, const T& value, vector_type<std::pair<T, T>>& intersections) const
+    {
+        findIntersectionsWithValue(node, value, intersections);
         // Test against values stored into descendants of this node
         if (!isLeaf(node))
         {
@@ -361,6 +1887,147 @@ private:
         }
     }
 
+    // Shallowest depth with at least nbTasks subtrees, counting the leaves above it
+    std::size_t getTaskDepth(std::size_t nbTasks) const
+    {
+        auto nodes = vector_type<const Node*>(1, mRoot.get());
+        auto depth = std::size_t(0);
+        while (nodes.size() < nbTasks)
+        {
+            auto nextNodes = vector_type<const Node*>();
+            for (auto node : nodes)
+            {
+                if (isLeaf(node))
+                    nextNodes.push_back(node);
+                else
+                {
+                    for (const auto& child : node->children)
+                        nextNodes.push_back(child.get());
+                }
+            }
+            if (nextNodes.size() == nodes.size())
+                break;
+            nodes = std::move(nextNodes);
+            ++depth;
+        }
+        return depth;
+    }
+
+    // Tasks in the order in which findAllIntersections(node, intersections) outputs their intersections
+    void addIntersectionTasks(Node* node, std::size_t depth, std::size_t taskDepth, vector_type<IntersectionTask>& tasks) const
+    {
+        if (depth >= taskDepth || isLeaf(node))
+        {
+            tasks.push_back(IntersectionTask{IntersectionTask::Type::Subtree, node, 0, 0, 0});
+            return;
+        }
+        tasks.push_back(IntersectionTask{IntersectionTask::Type::Node, node, 0, 0, 0});
+        for (auto i = std::size_t(0); i < node->children.size(); ++i)
+        {
+            for (auto begin = std::size_t(0); begin < node->values.size(); begin += ValuesPerIntersectionTask)
+            {
+                tasks.push_back(IntersectionTask{IntersectionTask::Type::Child, node, i, begin,
+                    std::min(begin + ValuesPerIntersectionTask, node->values.size())});
+            }
+        }
+        for (const auto& child : node->children)
+            addIntersectionTasks(child.get(), depth + 1, taskDepth, tasks);
+    }
+
+    void runIntersectionTask(const IntersectionTask& task, vector_type<std::pair<T, T>>& intersections) const
+    {
+        switch (task.type)
+        {
+            case IntersectionTask::Type::Subtree:
+                findAllIntersections(task.node, intersections);
+                break;
+            case IntersectionTask::Type::Node:
+                findIntersectionsInNode(task.node, intersections);
+                break;
+            case IntersectionTask::Type::Child:
+                for (auto i = task.begin; i < task.end; ++i)
+                    findIntersectionsInDescendants(task.node->children[task.child].get(), task.node->values[i], intersections);
+                break;
+        }
+    }
+
+    // Fill node with values as add does when they are added in order, the values going
+    // to the children are moved to childValues, returns whether node is split
+    bool fillNode(Node* node, std::size_t depth, const Box<Float>& box, vector_type<T>& values,
+        std::array<vector_type<T>, 4>& childValues, MakeUnique<LeafGrid>& makeGrid)
+    {
+        for (const auto& value : values)
+            addToSummary(node, mGetBox(value));
+        if (depth >= MaxDepth)
+        {
+            for (const auto& value : values)
+                addValueAtMaxDepth(node, box, value, makeGrid);
+            return false;
+        }
+        if (values.size() <= Threshold)
+        {
+            node->values = std::move(values);
+            return false;
+        }
+        for (auto& value : values)
+        {
+            auto i = getQuadrant(box, mGetBox(value));
+            if (i != -1)
+                childValues[static_cast<std::size_t>(i)].push_back(std::move(value));
+            else
+                node->values.push_back(std::move(value));
+        }
+        return true;
+    }
+
+    // The nodes are taken from the share of the reserve of the task, then from its policy
+    void buildSubtree(Node* node, std::size_t depth, const Box<Float>& box, vector_type<T>& values, BuildTask& task)
+    {
+        auto childValues = std::array<vector_type<T>, 4>();
+        if (!fillNode(node, depth, box, values, childValues, task.makeGrid))
+            return;
+        for (auto i = std::size_t(0); i < node->children.size(); ++i)
+        {
+            if (task.spareNodes.empty())
+                node->children[i] = task.makeUnique();
+            else
+            {
+                node->children[i] = std::move(task.spareNodes.back());
+                task.spareNodes.pop_back();
+            }
+            buildSubtree(node->children[i].get(), depth + 1, computeBox(box, static_cast<int>(i)), childValues[i], task);
+        }
+    }
+
+    template <typename P>
+    std::pair<const T*, Float> findClosestInNode (
+        const Box<Float>& searchBox,
+        std::pair<const T*, Float> best,
+        const Node& node,
+        P&& predicate
+    ) const
+    {
+        const Float& bestDist = best.second;
+        if (node.grid)
+        {
+            auto closest = node.grid->findClosest(searchBox, {LeafGrid::npos, bestDist},
+                [&node, &predicate](std::size_t i, const Box<Float>& currBox){ return predicate(node.values[i], currBox); });
+            if (closest.first != LeafGrid::npos)
+                best = std::make_pair(&node.values[closest.first], closest.second);
+        }
+        else
+        {
+            for (const auto& itm : node.values)
+            {
+                auto currBox = mGetBox(itm);
+                const Float currDist = distance(currBox, searchBox);
+                if (currDist < bestDist && predicate(itm, currBox))
+                    best = std::make_pair(&itm, currDist);
+            }
+        }
+        return best;
+    }
+
     template <typename P>
     std::pair<const T*, Float> findClosestImpl (
         const Box<Float>& searchBox,
@@ -370,17 +2037,10 @@ private:
         P&& predicate
     ) const
     {
-        const Float& bestDist = best.second;
-        if (distance(searchBox, nodeBox) > bestDist)
+        if (distance(searchBox, nodeBox) > best.second)
             return best;
 
-        for (const auto& itm : node.values)
-        {
-            auto currBox = mGetBox(itm);
-            const Float currDist = distance(currBox, searchBox);
-            if (currDist < bestDist && predicate(itm, currBox))
-                best = std::make_pair(&itm, currDist);
-        }
+        best = findClosestInNode(searchBox, best, node, predicate);
 
         const std::size_t rl = (searchBox.left * 2 + searchBox.width > nodeBox.left * 2 + nodeBox.width ? 1 : 0);
         const std::size_t bt = (searchBox.top * 2 + searchBox.height > nodeBox.top * 2 + nodeBox.height ? 1 : 0);
@@ -401,6 +2061,152 @@ private:
 
         return best;
     }
+
+public:
+    // Query that visits at most a number of nodes or runs at most a duration at each
+    // resume, to spread a large query over several frames. The values are appended
+    // in the same order as query. The quadtree must not be modified while a cursor
+    // is not finished.
+    class QueryCursor
+    {
+    public:
+        QueryCursor(const Quadtree& quadtree, const Box<Float>& box) : mQuadtree(&quadtree), mBox(box)
+        {
+            if (box.intersects(quadtree.mBox))
+                mStack.push_back(Frame{quadtree.mRoot.get(), quadtree.mBox});
+        }
+
+        bool isFinished() const
+        {
+            return mStack.empty();
+        }
+
+        // Visit at most maxNodes nodes, return true once the query is finished
+        bool resume(std::size_t maxNodes, vector_type<T>& values)
+        {
+            for (auto i = std::size_t(0); i < maxNodes && !isFinished(); ++i)
+                visitNode(values);
+            return isFinished();
+        }
+
+        // Visit nodes until the budget is spent, it is checked after each node
+        bool resumeFor(std::chrono::steady_clock::duration budget, vector_type<T>& values)
+        {
+            auto deadline = std::chrono::steady_clock::now() + budget;
+            while (!isFinished())
+            {
+                visitNode(values);
+                if (std::chrono::steady_clock::now() >= deadline)
+                    break;
+            }
+            return isFinished();
+        }
+
+    private:
+        struct Frame
+        {
+            const Node* node;
+            Box<Float> box;
+        };
+
+        const Quadtree* mQuadtree;
+        Box<Float> mBox;
+        vector_type<Frame> mStack;
+
+        void visitNode(vector_type<T>& values)
+        {
+            auto frame = mStack.back();
+            mStack.pop_back();
+            mQuadtree->queryValues(frame.node, mBox, values);
+            if (!mQuadtree->isLeaf(frame.node))
+            {
+                // In reverse to visit the children in order
+                for (auto i = frame.node->children.size(); i-- > 0;)
+                {
+                    auto childBox = mQuadtree->computeBox(frame.box, static_cast<int>(i));
+                    if (mBox.intersects(childBox))
+                        mStack.push_back(Frame{frame.node->children[i].get(), childBox});
+                }
+            }
+        }
+    };
+
+    // findAllIntersections that visits at most a number of nodes or runs at most a
+    // duration at each resume. Each node is tested against itself and the values of
+    // its ancestors, the pairs are the same as findAllIntersections but in another
+    // order. The quadtree must not be modified while a cursor is not finished.
+    class IntersectionCursor
+    {
+    public:
+        explicit IntersectionCursor(const Quadtree& quadtree) : mQuadtree(&quadtree)
+        {
+            mPath.push_back(Frame{quadtree.mRoot.get(), 0, false});
+        }
+
+        bool isFinished() const
+        {
+            return mPath.empty();
+        }
+
+        // Visit at most maxNodes nodes, return true once the traversal is finished
+        bool resume(std::size_t maxNodes, vector_type<std::pair<T, T>>& intersections)
+        {
+            for (auto i = std::size_t(0); i < maxNodes; ++i)
+            {
+                if (!visitNextNode(intersections))
+                    break;
+            }
+            return isFinished();
+        }
+
+        // Visit nodes until the budget is spent, it is checked after each node
+        bool resumeFor(std::chrono::steady_clock::duration budget, vector_type<std::pair<T, T>>& intersections)
+        {
+            auto deadline = std::chrono::steady_clock::now() + budget;
+            while (visitNextNode(intersections))
+            {
+                if (std::chrono::steady_clock::now() >= deadline)
+                    break;
+            }
+            return isFinished();
+        }
+
+    private:
+        struct Frame
+        {
+            const Node* node;
+            std::size_t nextChild;
+            bool visited;
+        };
+
+        const Quadtree* mQuadtree;
+        vector_type<Frame> mPath; // From the root to the current node
+
+        // Return false if there is no node left
+        bool visitNextNode(vector_type<std::pair<T, T>>& intersections)
+        {
+            while (!mPath.empty())
+            {
+                auto& frame = mPath.back();
+                if (!frame.visited)
+                {
+                    frame.visited = true;
+                    mQuadtree->findIntersectionsInNode(frame.node, intersections);
+                    for (auto ancestor = std::begin(mPath); ancestor + 1 != std::end(mPath); ++ancestor)
+                    {
+                        for (const auto& value : ancestor->node->values)
+                            mQuadtree->findIntersectionsWithValue(frame.node, value, intersections);
+                    }
+                    return true;
+                }
+                if (mQuadtree->isLeaf(frame.node) || frame.nextChild == frame.node->children.size())
+                    mPath.pop_back();
+                else
+                    mPath.push_back(Frame{frame.node->children[frame.nextChild++].get(), 0, false});
+            }
+            return false;
+        }
+    };
 };
 
 }
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <functional>
+#include <unordered_set>
+#include "Executor.h"
+#include "PairCache.h"
+#include "Quadtree.h"
+
+namespace quadtree
+{
+
+// Values that are awake or asleep, like the bodies at rest of a physics engine. The
+// sleeping values are kept in their own quadtree so that the search for intersections
+// never enters a subtree where all the values sleep: it only tests the pairs with an
+// awake value, and its cost is proportional to the number of awake values. The awake
+// values are also kept in a hash set so that the operations find the layer of a value
+// without searching it, Hash and Less are the ones of the PairCache of the touching pairs.
+template<
+    typename T,
+    typename GetBox,
+    typename Equal = std::equal_to<T>,
+    typename Float = float,
+    template <typename> class Allocator = std::allocator,
+    template <typename> class MakeUnique = detail::StdMakeUnique,
+    std::size_t LeafGridResolution = 0,
+    std::size_t Threshold = 16,
+    std::size_t MaxDepth = 8,
+    typename Hash = std::hash<T>,
+    typename Less = std::less<T>
+>
+class SleepingQuadtree
+{
+public:
+    using Layer = Quadtree<T, GetBox, Equal, Float, Allocator, MakeUnique, LeafGridResolution, Threshold, MaxDepth>;
+
+    template <typename U>
+    using vector_type = typename Layer::template vector_type<U>;
+
+    SleepingQuadtree(const Box<Float>& box, const GetBox& getBox = GetBox(),
+        const Equal& equal = Equal(), const Hash& hash = Hash(), const Less& less = Less()) :
+        mAwake(box, getBox, equal), mSleeping(box, getBox, equal), mGetBox(getBox),
+        mAwakeValues(0, hash, equal), mTouchingPairs(hash, equal, less)
+    {
+
+    }
+
+    void add(const T& value, bool awake = true)
+    {
+        if (awake)
+            mAwakeValues.insert(value);
+        getLayer(awake).add(value);
+    }
+
+    void remove(const T& value)
+    {
+        getLayer(mAwakeValues.erase(value) > 0).remove(value);
+    }
+
+    void update(const T& value, const Box<Float>& oldBox)
+    {
+        getLayer(isAwake(value)).update(value, oldBox);
+    }
+
+    bool isAwake(const T& value) const
+    {
+        return mAwakeValues.count(value) > 0;
+    }
+
+    // Does nothing if value is already awake
+    void wake(const T& value)
+    {
+        if (mAwakeValues.insert(value).second)
+        {
+            mSleeping.remove(value);
+            mAwake.add(value);
+        }
+    }
+
+    // Does nothing if value is already asleep
+    void sleep(const T& value)
+    {
+        if (mAwakeValues.erase(value) > 0)
+        {
+            mAwake.remove(value);
+            mSleeping.add(value);
+        }
+    }
+
+    // The awake values come first
+    vector_type<T> query(const Box<Float>& box) const
+    {
+        auto values = mAwake.query(box);
+        auto sleepingValues = mSleeping.query(box);
+        values.insert(std::end(values), std::begin(sleepingValues), std::end(sleepingValues));
+        return values;
+    }
+
+    template <typename P>
+    const T* findClosest(const Box<Float>& box, P&& predicate) const
+    {
+        auto awakeValue = mAwake.findClosest(box, predicate);
+        auto sleepingValue = mSleeping.findClosest(box, predicate);
+        if (awakeValue == nullptr)
+            return sleepingValue;
+        if (sleepingValue == nullptr)
+            return awakeValue;
+        return distance(box, mGetBox(*sleepingValue)) < distance(box, mGetBox(*awakeValue)) ? sleepingValue : awakeValue;
+    }
+
+    const T* findClosest(const Box<Float>& box) const
+    {
+        return findClosest(box, [](const T&, const Box<Float>&) {return true;});
+    }
+
+    // The intersections between awake values, followed by the ones between an awake
+    // value and a sleeping value in this order
+    vector_type<std::pair<T, T>> findAllIntersections() const
+    {
+        auto executor = SequentialExecutor();
+        return findAllIntersections(executor);
+    }
+
+    // Same intersections in the same order, see Quadtree for the executors
+    template <typename Executor>
+    vector_type<std::pair<T, T>> findAllIntersections(Executor& executor) const
+    {
+        auto intersections = mAwake.findAllIntersections(executor);
+        auto touchingPairs = findTouchingPairs(executor);
+        intersections.insert(std::end(intersections), std::begin(touchingPairs), std::end(touchingPairs));
+        return intersections;
+    }
+
+    // Same intersections, onTouched(awakeValue, sleepingValue) is also called for the
+    // sleeping values newly touched by an awake value: the pairs that were not intersecting
+    // with this value asleep and the other awake at the previous call of this overload.
+    // A resting contact is thus reported once. The calls come in order, once the layers have
+    // been searched, and may wake the sleeping value, whose own intersections are then found
+    // from the next call.
+    template <typename Executor, typename F>
+    vector_type<std::pair<T, T>> findAllIntersections(Executor& executor, F&& onTouched)
+    {
+        auto intersections = mAwake.findAllIntersections(executor);
+        auto touchingPairs = findTouchingPairs(executor);
+        intersections.insert(std::end(intersections), std::begin(touchingPairs), std::end(touchingPairs));
+        // The cache stores the pairs in its own order with whether the first value is the
+        // awake one, the new pairs are put back in (awake, sleeping) order before any value
+        // is woken
+        auto newPairs = vector_type<std::pair<T, T>>();
+        auto onBegin = [this, &newPairs](const T& a, const T& b, bool& isFirstAwake)
+        {
+            isFirstAwake = isAwake(a);
+            if (isFirstAwake)
+                newPairs.emplace_back(a, b);
+            else
+                newPairs.emplace_back(b, a);
+        };
+        // The values swapped their states
+        auto onPersist = [this, &onBegin](const T& a, const T& b, bool& isFirstAwake)
+        {
+            if (isAwake(a) != isFirstAwake)
+                onBegin(a, b, isFirstAwake);
+        };
+        mTouchingPairs.update(touchingPairs, onBegin, onPersist, [](const T&, const T&, bool&){});
+        for (const auto& pair : newPairs)
+            onTouched(pair.first, pair.second);
+        return intersections;
+    }
+
+    const Box<Float>& area() const
+    {
+        return mAwake.area();
+    }
+
+    MemoryUsage memoryUsage() const
+    {
+        auto usage = mAwake.memoryUsage();
+        usage += mSleeping.memoryUsage();
+        usage += mTouchingPairs.memoryUsage();
+        // The size of the hash set is estimated from a node per value and a pointer per bucket
+        usage.indexes += mAwakeValues.bucket_count() * sizeof(void*) +
+            mAwakeValues.size() * (sizeof(void*) + sizeof(T));
+        return usage;
+    }
+
+    // To configure the layers, for instance to enable hashing or maintenance
+    Layer& getAwakeLayer()
+    {
+        return mAwake;
+    }
+
+    const Layer& getAwakeLayer() const
+    {
+        return mAwake;
+    }
+
+    Layer& getSleepingLayer()
+    {
+        return mSleeping;
+    }
+
+    const Layer& getSleepingLayer() const
+    {
+        return mSleeping;
+    }
+
+private:
+    Layer mAwake;
+    Layer mSleeping;
+    GetBox mGetBox;
+    std::unordered_set<T, Hash, Equal, Allocator<T>> mAwakeValues;
+    PairCache<T, bool, Hash, Equal, Less, Allocator> mTouchingPairs; // Awake and sleeping pairs of the last call
+
+    Layer& getLayer(bool awake)
+    {
+        return awake ? mAwake : mSleeping;
+    }
+
+    // The intersections between an awake value and a sleeping value, in this order
+    template <typename Executor>
+    vector_type<std::pair<T, T>> findTouchingPairs(Executor& executor) const
+    {
+        auto awakeValues = vector_type<T>();
+        auto boxes = vector_type<Box<Float>>();
+        mAwake.forEachNode([this, &awakeValues, &boxes](typename Layer::LocationalCode, const Box<Float>&,
+            const auto& values, bool)
+        {
+            for (const auto& value : values)
+            {
+                awakeValues.push_back(value);
+                boxes.push_back(mGetBox(value));
+            }
+        });
+        auto results = mSleeping.query(boxes, executor);
+        auto pairs = vector_type<std::pair<T, T>>();
+        for (auto i = std::size_t(0); i < awakeValues.size(); ++i)
+        {
+            for (const auto& other : results[i])
+                pairs.emplace_back(awakeValues[i], other);
+        }
+        return pairs;
+    }
+};
+
+}
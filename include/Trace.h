@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include "Box.h"
+
+namespace quadtree
+{
+
+enum class TraceOperation : std::uint8_t
+{
+    Add,
+    Remove,
+    Update,
+    Query,
+    FindAllIntersections
+};
+
+template<typename Float>
+struct TraceEvent
+{
+    TraceOperation operation;
+    Box<Float> box; // Box of the value or of the query
+    Box<Float> oldBox; // Previous box of an updated value
+};
+
+// Recorder for Quadtree that writes the operations to a binary stream
+//
+// The trace starts with the magic "QTTR", a version byte, sizeof(Float) and the area of
+// the quadtree, then each operation is a byte followed by its boxes in native endianness.
+// The operations are written under a mutex, so that the const operations of a recording
+// quadtree can still be called from several threads at once.
+template<typename Float>
+class TraceRecorder
+{
+public:
+    static constexpr auto Magic = std::array<char, 4>{'Q', 'T', 'T', 'R'};
+    static constexpr auto Version = std::uint8_t(2);
+
+    TraceRecorder() = default;
+
+    // The stream moves with the recorder, the mutex does not
+    TraceRecorder(TraceRecorder&& other) noexcept : mStream(other.mStream)
+    {
+        other.mStream = nullptr;
+    }
+
+    TraceRecorder& operator=(TraceRecorder&& other) noexcept
+    {
+        mStream = other.mStream;
+        other.mStream = nullptr;
+        return *this;
+    }
+
+    // Nothing is recorded while there is no stream, area is the area of the recorded
+    // quadtree so that the trace can be replayed in the same coordinates
+    void setStream(std::ostream* stream, const Box<Float>& area)
+    {
+        auto lock = std::unique_lock<std::mutex>(mMutex);
+        mStream = stream;
+        if (mStream)
+        {
+            mStream->write(Magic.data(), Magic.size());
+            writeByte(Version);
+            writeByte(static_cast<std::uint8_t>(sizeof(Float)));
+            writeBox(area);
+        }
+    }
+
+    std::ostream* getStream() const
+    {
+        auto lock = std::unique_lock<std::mutex>(mMutex);
+        return mStream;
+    }
+
+    void onAdd(const Box<Float>& box)
+    {
+        write(TraceOperation::Add, box);
+    }
+
+    void onRemove(const Box<Float>& box)
+    {
+        write(TraceOperation::Remove, box);
+    }
+
+    void onUpdate(const Box<Float>& oldBox, const Box<Float>& newBox)
+    {
+        auto lock = std::unique_lock<std::mutex>(mMutex);
+        if (mStream)
+        {
+            writeEvent(TraceOperation::Update, newBox);
+            writeBox(oldBox);
+        }
+    }
+
+    void onQuery(const Box<Float>& box)
+    {
+        write(TraceOperation::Query, box);
+    }
+
+    void onFindAllIntersections()
+    {
+        auto lock = std::unique_lock<std::mutex>(mMutex);
+        if (mStream)
+            writeByte(static_cast<std::uint8_t>(TraceOperation::FindAllIntersections));
+    }
+
+private:
+    mutable std::mutex mMutex;
+    std::ostream* mStream = nullptr;
+
+    void write(TraceOperation operation, const Box<Float>& box)
+    {
+        auto lock = std::unique_lock<std::mutex>(mMutex);
+        if (mStream)
+            writeEvent(operation, box);
+    }
+
+    void writeEvent(TraceOperation operation, const Box<Float>& box)
+    {
+        writeByte(static_cast<std::uint8_t>(operation));
+        writeBox(box);
+    }
+
+    void writeByte(std::uint8_t byte)
+    {
+        mStream->put(static_cast<char>(byte));
+    }
+
+    void writeBox(const Box<Float>& box)
+    {
+        auto data = std::array<Float, 4>{box.left, box.top, box.width, box.height};
+        auto bytes = std::array<char, sizeof(data)>();
+        std::memcpy(bytes.data(), data.data(), sizeof(data));
+        mStream->write(bytes.data(), bytes.size());
+    }
+};
+
+template<typename Float>
+constexpr std::array<char, 4> TraceRecorder<Float>::Magic;
+
+template<typename Float>
+constexpr std::uint8_t TraceRecorder<Float>::Version;
+
+template<typename Float>
+class TraceReader
+{
+public:
+    // Check the header of the trace
+    explicit TraceReader(std::istream& stream) : mStream(stream)
+    {
+        auto header = std::array<char, 6>();
+        mValid = static_cast<bool>(mStream.read(header.data(), header.size())) &&
+            std::equal(TraceRecorder<Float>::Magic.begin(), TraceRecorder<Float>::Magic.end(), header.begin()) &&
+            static_cast<std::uint8_t>(header[4]) == TraceRecorder<Float>::Version &&
+            static_cast<std::uint8_t>(header[5]) == sizeof(Float) &&
+            readBox(mArea);
+    }
+
+    bool isValid() const
+    {
+        return mValid;
+    }
+
+    // Area of the recorded quadtree
+    const Box<Float>& getArea() const
+    {
+        return mArea;
+    }
+
+    // Return false at the end of the trace or if it is truncated
+    bool read(TraceEvent<Float>& event)
+    {
+        auto byte = char();
+        if (!mValid || !mStream.get(byte))
+            return false;
+        event.operation = static_cast<TraceOperation>(byte);
+        switch (event.operation)
+        {
+            case TraceOperation::Add:
+            case TraceOperation::Remove:
+            case TraceOperation::Query:
+                return readBox(event.box);
+            case TraceOperation::Update:
+                return readBox(event.box) && readBox(event.oldBox);
+            case TraceOperation::FindAllIntersections:
+                return true;
+            default:
+                mValid = false;
+                return false;
+        }
+    }
+
+private:
+    std::istream& mStream;
+    bool mValid;
+    Box<Float> mArea;
+
+    bool readBox(Box<Float>& box)
+    {
+        auto bytes = std::array<char, 4 * sizeof(Float)>();
+        if (!mStream.read(bytes.data(), bytes.size()))
+        {
+            mValid = false;
+            return false;
+        }
+        auto data = std::array<Float, 4>();
+        std::memcpy(data.data(), bytes.data(), bytes.size());
+        box = Box<Float>(data[0], data[1], data[2], data[3]);
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "Box.h"
+
+namespace quadtree
+{
+
+// Snapshot of the nodes of a quadtree that can be written as an SVG or as a JSON
+// to diagnose imbalanced subdivisions
+template<typename Float>
+class TreeDump
+{
+public:
+    enum class Colouring
+    {
+        Values, // Number of values of the leaves
+        Queries // Number of queries visiting the leaves
+    };
+
+    struct Cell
+    {
+        std::uint64_t code;
+        std::size_t depth;
+        Box<Float> box;
+        std::size_t nbValues; // In an interior node, the values straddling its children
+        bool leaf;
+        std::size_t nbQueries;
+    };
+
+    template <typename Quadtree>
+    explicit TreeDump(const Quadtree& quadtree) : mBox(quadtree.area())
+    {
+        quadtree.forEachNode([this](std::uint64_t code, const Box<Float>& box, const auto& values, bool leaf)
+        {
+            mCells.push_back(Cell{code, getDepth(code), box, values.size(), leaf, 0});
+        });
+    }
+
+    // Count the query in the nodes its traversal visits, the queries can come from a trace
+    void addQuery(const Box<Float>& box)
+    {
+        for (auto& cell : mCells)
+        {
+            if (box.intersects(cell.box))
+                ++cell.nbQueries;
+        }
+    }
+
+    const std::vector<Cell>& getCells() const
+    {
+        return mCells;
+    }
+
+    // The leaves are filled with a colour scaled by the maximum over the leaves, the
+    // borders get thinner with the depth and the interior nodes are labelled with their straddlers
+    void writeSvg(std::ostream& stream, Colouring colouring = Colouring::Values, double size = 1024.0) const
+    {
+        auto scale = size / static_cast<double>(std::max(mBox.width, mBox.height));
+        auto width = scale * static_cast<double>(mBox.width);
+        auto height = scale * static_cast<double>(mBox.height);
+        auto getCount = [colouring](const Cell& cell)
+        {
+            return colouring == Colouring::Values ? cell.nbValues : cell.nbQueries;
+        };
+        auto maxCount = std::size_t(1);
+        for (const auto& cell : mCells)
+        {
+            if (cell.leaf)
+                maxCount = std::max(maxCount, getCount(cell));
+        }
+        stream << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height
+            << "\" viewBox=\"0 0 " << width << ' ' << height << "\">\n";
+        for (const auto& cell : mCells)
+        {
+            auto t = static_cast<double>(getCount(cell)) / static_cast<double>(maxCount);
+            auto shade = static_cast<int>(255.0 * (1.0 - t) + 0.5);
+            stream << "<rect x=\"" << scale * static_cast<double>(cell.box.left - mBox.left)
+                << "\" y=\"" << scale * static_cast<double>(cell.box.top - mBox.top)
+                << "\" width=\"" << scale * static_cast<double>(cell.box.width)
+                << "\" height=\"" << scale * static_cast<double>(cell.box.height) << "\" fill=\"";
+            if (!cell.leaf)
+                stream << "none";
+            else if (colouring == Colouring::Values)
+                stream << "rgb(255," << shade << ',' << shade << ')';
+            else
+                stream << "rgb(" << shade << ',' << shade << ",255)";
+            stream << "\" stroke=\"black\" stroke-width=\"" << std::max(2.0 / static_cast<double>(cell.depth + 1), 0.25)
+                << "\"><title>code " << cell.code << ", depth " << cell.depth << ", " << cell.nbValues << " values, "
+                << cell.nbQueries << " queries</title></rect>\n";
+        }
+        // The labels are drawn above the cells of the children
+        for (const auto& cell : mCells)
+        {
+            if (!cell.leaf && cell.nbValues > 0)
+            {
+                auto center = cell.box.getCenter();
+                stream << "<text x=\"" << scale * static_cast<double>(center.x - mBox.left)
+                    << "\" y=\"" << scale * static_cast<double>(center.y - mBox.top)
+                    << "\" text-anchor=\"middle\" dominant-baseline=\"middle\" font-size=\""
+                    << std::max(scale * static_cast<double>(cell.box.height) / 16.0, 4.0) << "\">"
+                    << cell.nbValues << "</text>\n";
+            }
+        }
+        stream << "</svg>\n";
+    }
+
+    void writeJson(std::ostream& stream) const
+    {
+        stream << "{\n  \"area\": ";
+        writeBox(stream, mBox);
+        stream << ",\n  \"nodes\": [\n";
+        for (auto i = std::size_t(0); i < mCells.size(); ++i)
+        {
+            const auto& cell = mCells[i];
+            stream << "    {\"code\": " << cell.code << ", \"depth\": " << cell.depth << ", \"box\": ";
+            writeBox(stream, cell.box);
+            stream << ", \"values\": " << cell.nbValues << ", \"leaf\": " << (cell.leaf ? "true" : "false")
+                << ", \"queries\": " << cell.nbQueries << "}" << (i + 1 < mCells.size() ? "," : "") << '\n';
+        }
+        stream << "  ]\n}\n";
+    }
+
+private:
+    Box<Float> mBox;
+    std::vector<Cell> mCells;
+
+    static std::size_t getDepth(std::uint64_t code)
+    {
+        auto depth = std::size_t(0);
+        for (; code > 1; code >>= 2)
+            ++depth;
+        return depth;
+    }
+
+    static void writeBox(std::ostream& stream, const Box<Float>& box)
+    {
+        stream << '[' << box.left << ", " << box.top << ", " << box.width << ", " << box.height << ']';
+    }
+};
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "Box.h"
+#include "Workloads.h"
+
+using workloads::Node;
+using workloads::generateRandomNodes;
+using workloads::moveNode;
+
+struct GetBox
+{
+    quadtree::Box<float> operator()(Node* node) const
+    {
+        return node->box;
+    }
+};
+
+inline std::vector<Node*> query(const quadtree::Box<float>& box, std::vector<Node>& nodes, const std::vector<bool>& removed)
+{
+    auto intersections = std::vector<Node*>();
+    for (auto& n : nodes)
+    {
+        if (removed.size() == 0 || !removed[n.id])
+        {
+            if (box.intersects(n.box))
+                intersections.push_back(&n);
+        }
+    }
+    return intersections;
+}
+
+inline std::vector<std::pair<Node*, Node*>> findAllIntersections(std::vector<Node>& nodes, const std::vector<bool>& removed)
+{
+    auto intersections = std::vector<std::pair<Node*, Node*>>();
+    for (auto i = std::size_t(0); i < nodes.size(); ++i)
+    {
+        if (removed.size() == 0 || !removed[i])
+        {
+            for (auto j = std::size_t(0); j < i; ++j)
+            {
+                if (removed.size() == 0 || !removed[j])
+                {
+                    if (nodes[i].box.intersects(nodes[j].box))
+                        intersections.emplace_back(&nodes[i], &nodes[j]);
+                }
+            }
+        }
+    }
+    return intersections;
+}
+
+inline bool checkIntersections(std::vector<Node*> nodes1, std::vector<Node*> nodes2)
+{
+    if (nodes1.size() != nodes2.size())
+        return false;
+    std::sort(std::begin(nodes1), std::end(nodes1));
+    std::sort(std::begin(nodes2), std::end(nodes2));
+    return nodes1 == nodes2;
+}
+
+inline bool checkIntersections(std::vector<std::pair<Node*, Node*>> intersections1,
+    std::vector<std::pair<Node*, Node*>> intersections2)
+{
+    if (intersections1.size() != intersections2.size())
+        return false;
+    for (auto& intersection : intersections1)
+    {
+        if (intersection.first >= intersection.second)
+            std::swap(intersection.first, intersection.second);
+    }
+    for (auto& intersection : intersections2)
+    {
+        if (intersection.first >= intersection.second)
+            std::swap(intersection.first, intersection.second);
+    }
+    std::sort(std::begin(intersections1), std::end(intersections1));
+    std::sort(std::begin(intersections2), std::end(intersections2));
+    return intersections1 == intersections2;
+}
@@ -0,0 +1,130 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "BlockMakeUnique.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using QuadtreeType = Quadtree<Node*, GetBox>;
+using HybridQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, detail::StdMakeUnique, 4>;
+using BlockQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, BlockMakeUnique>;
+using BlockHybridQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, BlockMakeUnique, 4>;
+
+template <typename Container>
+void checkCompact(std::size_t n, typename Container::NodeOrder order, bool hashing, float scale, bool reserve = false)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    for (auto& node : nodes)
+    {
+        node.box.left *= scale;
+        node.box.top *= scale;
+        node.box.width *= scale;
+        node.box.height *= scale;
+    }
+    auto quadtree = Container(box);
+    quadtree.setHashingEnabled(hashing);
+    if (reserve)
+        quadtree.reserve(n);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Churn to leave slack in the value buffers
+    auto generator = std::default_random_engine();
+    auto deathDistribution = std::uniform_int_distribution<int>(0, 1);
+    auto removed = std::vector<bool>(nodes.size());
+    for (auto& node : nodes)
+    {
+        removed[node.id] = deathDistribution(generator) != 0;
+        if (removed[node.id])
+            quadtree.remove(&node);
+    }
+    auto leaves = std::vector<typename Container::LocationalCode>();
+    quadtree.forEachLeaf([&leaves](auto code, const auto&, const auto&){ leaves.push_back(code); });
+    auto usage = quadtree.memoryUsage();
+    quadtree.compact(order);
+    // Same tree with no slack
+    auto compactedLeaves = std::vector<typename Container::LocationalCode>();
+    quadtree.forEachLeaf([&compactedLeaves](auto code, const auto&, const auto&){ compactedLeaves.push_back(code); });
+    ASSERT_EQ(leaves, compactedLeaves);
+    auto compactedUsage = quadtree.memoryUsage();
+    ASSERT_EQ(compactedUsage.nodes, usage.nodes);
+    ASSERT_EQ(compactedUsage.values, usage.values);
+    ASSERT_LE(compactedUsage.slack, usage.slack);
+    // Query
+    for (const auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            auto values = quadtree.query(node.box);
+            ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+                query(node.box, nodes, removed)));
+        }
+    }
+    // Find all intersections
+    auto intersections = quadtree.findAllIntersections();
+    ASSERT_TRUE(checkIntersections(std::vector<std::pair<Node*, Node*>>(std::begin(intersections), std::end(intersections)),
+        findAllIntersections(nodes, removed)));
+    // The tree can still be modified
+    for (auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            auto oldBox = node.box;
+            node.box.left *= 0.5f;
+            quadtree.update(&node, oldBox);
+        }
+    }
+    for (auto& node : nodes)
+    {
+        if (!removed[node.id])
+            quadtree.remove(&node);
+    }
+    ASSERT_EQ(quadtree.memoryUsage().values, 0);
+}
+
+}
+
+TEST_P(QuadtreeTest, CompactTest)
+{
+    checkCompact<QuadtreeType>(GetParam(), QuadtreeType::NodeOrder::BreadthFirst, false, 1.0f);
+    checkCompact<QuadtreeType>(GetParam(), QuadtreeType::NodeOrder::VanEmdeBoas, false, 1.0f);
+}
+
+TEST_P(QuadtreeTest, HashedCompactTest)
+{
+    checkCompact<QuadtreeType>(GetParam(), QuadtreeType::NodeOrder::VanEmdeBoas, true, 1.0f);
+}
+
+TEST_P(QuadtreeTest, HybridCompactTest)
+{
+    checkCompact<HybridQuadtree>(GetParam(), HybridQuadtree::NodeOrder::BreadthFirst, false, 0.01f);
+}
+
+TEST_P(QuadtreeTest, BlockCompactTest)
+{
+    checkCompact<BlockQuadtree>(GetParam(), BlockQuadtree::NodeOrder::BreadthFirst, false, 1.0f, true);
+    checkCompact<BlockQuadtree>(GetParam(), BlockQuadtree::NodeOrder::VanEmdeBoas, true, 1.0f, true);
+    checkCompact<BlockHybridQuadtree>(GetParam(), BlockHybridQuadtree::NodeOrder::BreadthFirst, false, 0.01f);
+}
+
+TEST(BlockMakeUniqueTest, Contiguous)
+{
+    auto makeUnique = BlockMakeUnique<Node>();
+    auto first = makeUnique();
+    auto second = makeUnique();
+    ASSERT_EQ(second.get(), first.get() + 1);
+    // The freed slots are reused
+    auto address = first.get();
+    first.reset();
+    auto third = makeUnique();
+    ASSERT_EQ(third.get(), address);
+    // The copies share the blocks
+    auto copy = makeUnique;
+    auto fourth = copy();
+    ASSERT_EQ(fourth.get(), second.get() + 1);
+}
@@ -0,0 +1,72 @@
+#include <chrono>
+#include "gtest/gtest.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using QuadtreeType = Quadtree<Node*, GetBox>;
+using HybridQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, detail::StdMakeUnique, 4>;
+
+template <typename Container>
+void checkCursors(std::vector<Node>& nodes)
+{
+    auto quadtree = Container(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // The query cursor returns the values in the same order
+    auto queryBox = Box<float>(0.2f, 0.3f, 0.5f, 0.4f);
+    auto expectedValues = quadtree.query(queryBox);
+    for (auto maxNodes : {std::size_t(1), std::size_t(7), std::numeric_limits<std::size_t>::max()})
+    {
+        auto cursor = quadtree.startQuery(queryBox);
+        auto values = typename Container::template vector_type<Node*>();
+        while (!cursor.resume(maxNodes, values)) {}
+        ASSERT_EQ(values, expectedValues);
+    }
+    auto queryCursor = quadtree.startQuery(queryBox);
+    auto values = typename Container::template vector_type<Node*>();
+    while (!queryCursor.resumeFor(std::chrono::microseconds(1), values)) {}
+    ASSERT_EQ(values, expectedValues);
+    // The intersection cursor returns the same pairs
+    auto expectedIntersections = findAllIntersections(nodes, std::vector<bool>());
+    for (auto maxNodes : {std::size_t(1), std::size_t(7), std::numeric_limits<std::size_t>::max()})
+    {
+        auto cursor = quadtree.startFindAllIntersections();
+        auto intersections = typename Container::template vector_type<std::pair<Node*, Node*>>();
+        while (!cursor.resume(maxNodes, intersections)) {}
+        ASSERT_TRUE(checkIntersections(std::vector<std::pair<Node*, Node*>>(std::begin(intersections),
+            std::end(intersections)), expectedIntersections));
+        ASSERT_TRUE(cursor.isFinished());
+    }
+    auto intersectionCursor = quadtree.startFindAllIntersections();
+    auto intersections = typename Container::template vector_type<std::pair<Node*, Node*>>();
+    while (!intersectionCursor.resumeFor(std::chrono::microseconds(1), intersections)) {}
+    ASSERT_TRUE(checkIntersections(std::vector<std::pair<Node*, Node*>>(std::begin(intersections),
+        std::end(intersections)), expectedIntersections));
+}
+
+}
+
+TEST_P(QuadtreeTest, CursorTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    checkCursors<QuadtreeType>(nodes);
+}
+
+TEST_P(QuadtreeTest, HybridCursorTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    for (auto& node : nodes)
+    {
+        node.box.left *= 0.01f;
+        node.box.top *= 0.01f;
+        node.box.width *= 0.01f;
+        node.box.height *= 0.01f;
+    }
+    checkCursors<HybridQuadtree>(nodes);
+}
@@ -0,0 +1,132 @@
+#include <cstring>
+#include "gtest/gtest.h"
+#include "Executor.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using QuadtreeType = Quadtree<Node*, GetBox>;
+using HybridQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, detail::StdMakeUnique, 4>;
+
+using Bytes = std::vector<unsigned char>;
+
+template <typename U>
+void append(Bytes& bytes, const U& x)
+{
+    auto begin = reinterpret_cast<const unsigned char*>(&x);
+    bytes.insert(std::end(bytes), begin, begin + sizeof(U));
+}
+
+template <typename U, typename A>
+Bytes getBytes(const std::vector<U, A>& values)
+{
+    auto bytes = Bytes();
+    for (const auto& value : values)
+        append(bytes, value);
+    return bytes;
+}
+
+// Nodes with their values in order, and the summaries of the subtrees at each depth
+template <typename Container>
+Bytes getBytes(const Container& quadtree)
+{
+    auto bytes = Bytes();
+    quadtree.forEachNode([&bytes](std::uint64_t code, const Box<float>& box, const auto& values, bool leaf)
+    {
+        append(bytes, code);
+        append(bytes, box);
+        append(bytes, leaf);
+        append(bytes, values.size());
+        for (const auto& value : values)
+            append(bytes, value);
+    });
+    for (auto depth = std::size_t(0); depth <= 8; ++depth)
+    {
+        quadtree.queryLod(quadtree.area(), depth, [&bytes](const typename Container::NodeSummary& summary)
+        {
+            append(bytes, summary.box);
+            append(bytes, summary.bounds);
+            append(bytes, summary.count);
+            append(bytes, *summary.representative);
+            append(bytes, summary.depth);
+        });
+    }
+    return bytes;
+}
+
+template <typename Container, typename Executor>
+void checkDeterminism(std::vector<Node>& nodes, Executor& executor, bool hashing)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto values = std::vector<Node*>();
+    auto boxes = std::vector<Box<float>>();
+    for (auto& node : nodes)
+    {
+        values.push_back(&node);
+        boxes.push_back(node.box);
+    }
+    // Serial path
+    auto serialQuadtree = Container(box);
+    serialQuadtree.setHashingEnabled(hashing);
+    for (auto value : values)
+        serialQuadtree.add(value);
+    // Parallel path
+    auto quadtree = Container(box);
+    quadtree.setHashingEnabled(hashing);
+    quadtree.build(values, executor);
+    ASSERT_EQ(getBytes(quadtree), getBytes(serialQuadtree));
+    auto results = quadtree.query(boxes, executor);
+    ASSERT_EQ(results.size(), boxes.size());
+    for (auto i = std::size_t(0); i < boxes.size(); ++i)
+        ASSERT_EQ(getBytes(results[i]), getBytes(serialQuadtree.query(boxes[i])));
+    ASSERT_EQ(getBytes(quadtree.findAllIntersections(executor)), getBytes(serialQuadtree.findAllIntersections()));
+}
+
+template <typename Container>
+void checkDeterminism(std::vector<Node>& nodes)
+{
+    for (auto nbThreads : {1ul, 2ul, 3ul, 4ul, 8ul})
+    {
+        ThreadPool pool(nbThreads);
+        checkDeterminism<Container>(nodes, pool, false);
+        checkDeterminism<Container>(nodes, pool, true);
+        auto executor = ThreadExecutor(nbThreads);
+        checkDeterminism<Container>(nodes, executor, false);
+    }
+    auto executor = SequentialExecutor();
+    checkDeterminism<Container>(nodes, executor, false);
+#if defined(__cpp_lib_execution) && defined(TEST_EXECUTION_POLICIES)
+    auto policyExecutor = PolicyExecutor<std::execution::parallel_policy>(std::execution::par);
+    checkDeterminism<Container>(nodes, policyExecutor, false);
+#endif
+}
+
+}
+
+TEST_P(QuadtreeTest, DeterminismTest)
+{
+    auto n = std::min<std::size_t>(GetParam(), 1000);
+    for (auto distribution : workloads::Distributions)
+    {
+        auto nodes = workloads::generateNodes(n, distribution);
+        checkDeterminism<QuadtreeType>(nodes);
+    }
+}
+
+TEST_P(QuadtreeTest, HybridDeterminismTest)
+{
+    auto nodes = workloads::generateNodes(std::min<std::size_t>(GetParam(), 1000), workloads::Distribution::Clustered);
+    for (auto& node : nodes)
+    {
+        node.box.left *= 0.01f;
+        node.box.top *= 0.01f;
+        node.box.width *= 0.01f;
+        node.box.height *= 0.01f;
+    }
+    checkDeterminism<HybridQuadtree>(nodes);
+}
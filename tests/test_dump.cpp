@@ -0,0 +1,63 @@
+#include <sstream>
+#include "gtest/gtest.h"
+#include "Quadtree.h"
+#include "TreeDump.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using QuadtreeType = Quadtree<Node*, GetBox>;
+
+}
+
+TEST_P(QuadtreeTest, TreeDumpTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(GetParam());
+    auto quadtree = QuadtreeType(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto queries = std::vector<Box<float>>{Box<float>(0.1f, 0.1f, 0.2f, 0.3f), Box<float>(0.6f, 0.0f, 0.4f, 0.4f)};
+    auto dump = TreeDump<float>(quadtree);
+    for (const auto& query : queries)
+        dump.addQuery(query);
+    const auto& cells = dump.getCells();
+    // The dump contains each value once and its leaves are the ones of the quadtree
+    auto nbValues = std::size_t(0);
+    auto nbLeaves = std::size_t(0);
+    for (const auto& cell : cells)
+    {
+        nbValues += cell.nbValues;
+        if (cell.leaf)
+            ++nbLeaves;
+    }
+    ASSERT_EQ(nbValues, nodes.size());
+    auto nbQuadtreeLeaves = std::size_t(0);
+    quadtree.forEachLeaf([&nbQuadtreeLeaves](auto, const auto&, const auto&){ ++nbQuadtreeLeaves; });
+    ASSERT_EQ(nbLeaves, nbQuadtreeLeaves);
+    // The children follow their parent in depth-first order
+    ASSERT_EQ(cells.front().code, 1);
+    ASSERT_EQ(cells.front().depth, 0);
+    ASSERT_EQ(cells.front().nbQueries, queries.size());
+    for (const auto& cell : cells)
+    {
+        auto nbQueries = std::size_t(0);
+        for (const auto& query : queries)
+        {
+            if (query.intersects(cell.box))
+                ++nbQueries;
+        }
+        ASSERT_EQ(cell.nbQueries, nbQueries);
+    }
+    // Output
+    auto svg = std::ostringstream();
+    dump.writeSvg(svg, TreeDump<float>::Colouring::Queries);
+    ASSERT_EQ(svg.str().compare(0, 4, "<svg"), 0);
+    auto json = std::ostringstream();
+    dump.writeJson(json);
+    ASSERT_NE(json.str().find("\"nodes\""), std::string::npos);
+}
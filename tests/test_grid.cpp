@@ -0,0 +1,133 @@
+#include <memory>
+#include <random>
+#include "gtest/gtest.h"
+#include "Grid.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using GridType = Grid<Node*, GetBox>;
+using HybridQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, detail::StdMakeUnique, 4>;
+
+// Policy that can only construct objects without arguments, enough without leaf grids
+template <typename T>
+struct DefaultMakeUnique
+{
+    std::unique_ptr<T> operator()()
+    {
+        return std::make_unique<T>();
+    }
+};
+
+using DefaultQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, DefaultMakeUnique>;
+
+// Concentrate the nodes in a corner so that the leaves at the maximum depth overflow
+void shrinkNodes(std::vector<Node>& nodes, float scale)
+{
+    for (auto& node : nodes)
+    {
+        node.box.left *= scale;
+        node.box.top *= scale;
+        node.box.width *= scale;
+        node.box.height *= scale;
+    }
+}
+
+std::vector<bool> removeRandomNodes(std::vector<Node>& nodes)
+{
+    auto generator = std::default_random_engine();
+    auto deathDistribution = std::uniform_int_distribution<int>(0, 1);
+    auto removed = std::vector<bool>(nodes.size());
+    std::generate(std::begin(removed), std::end(removed),
+        [&generator, &deathDistribution](){ return deathDistribution(generator); });
+    return removed;
+}
+
+template <typename Container>
+void checkContainer(std::vector<Node>& nodes, bool removeHalf)
+{
+    auto container = Container(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    for (auto& node : nodes)
+        container.add(&node);
+    auto removed = std::vector<bool>();
+    if (removeHalf)
+    {
+        removed = removeRandomNodes(nodes);
+        for (auto& node : nodes)
+        {
+            if (removed[node.id])
+                container.remove(&node);
+        }
+    }
+    // Query
+    for (const auto& node : nodes)
+    {
+        if (removed.empty() || !removed[node.id])
+        {
+            auto values = container.query(node.box);
+            ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+                query(node.box, nodes, removed)));
+        }
+    }
+    // Find all intersections
+    auto intersections = container.findAllIntersections();
+    ASSERT_TRUE(checkIntersections(std::vector<std::pair<Node*, Node*>>(std::begin(intersections), std::end(intersections)),
+        findAllIntersections(nodes, removed)));
+    // Find closest to a box that is not in the container
+    auto searchBox = Box<float>(0.25f, 0.75f, 0.001f, 0.001f);
+    auto found = container.findClosest(searchBox);
+    auto closest = static_cast<Node*>(nullptr);
+    for (auto& node : nodes)
+    {
+        if ((removed.empty() || !removed[node.id]) &&
+            (closest == nullptr || distance(node.box, searchBox) < distance(closest->box, searchBox)))
+            closest = &node;
+    }
+    if (closest == nullptr)
+        ASSERT_EQ(found, nullptr);
+    else
+    {
+        ASSERT_NE(found, nullptr);
+        ASSERT_FLOAT_EQ(distance((*found)->box, searchBox), distance(closest->box, searchBox));
+    }
+}
+
+}
+
+TEST_P(QuadtreeTest, GridTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    checkContainer<GridType>(nodes, false);
+}
+
+TEST_P(QuadtreeTest, GridRemoveTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    checkContainer<GridType>(nodes, true);
+}
+
+TEST_P(QuadtreeTest, HybridQuadtreeTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    shrinkNodes(nodes, 0.01f);
+    checkContainer<HybridQuadtree>(nodes, false);
+}
+
+TEST_P(QuadtreeTest, HybridQuadtreeRemoveTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    shrinkNodes(nodes, 0.01f);
+    checkContainer<HybridQuadtree>(nodes, true);
+}
+
+TEST_P(QuadtreeTest, DefaultMakeUniqueTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    shrinkNodes(nodes, 0.01f);
+    checkContainer<DefaultQuadtree>(nodes, true);
+}
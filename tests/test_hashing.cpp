@@ -0,0 +1,106 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+void checkUpdate(std::size_t n, bool hashing)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto quadtree = Quadtree<Node*, GetBox>(box);
+    quadtree.setHashingEnabled(hashing);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto generator = std::default_random_engine();
+    for (auto maxDisplacement : {0.001f, 0.01f, 0.5f})
+    {
+        // Small, medium and large displacements
+        auto displacementDistribution = std::uniform_real_distribution<float>(-maxDisplacement, maxDisplacement);
+        for (auto& node : nodes)
+        {
+            auto oldBox = node.box;
+            moveNode(node, generator, displacementDistribution);
+            quadtree.update(&node, oldBox);
+        }
+        for (const auto& node : nodes)
+        {
+            auto values = quadtree.query(node.box);
+            ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+                query(node.box, nodes, {})));
+        }
+        ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+    }
+    // All the nodes are still removable
+    for (auto& node : nodes)
+        quadtree.remove(&node);
+    ASSERT_TRUE(quadtree.query(box).empty());
+}
+
+}
+
+TEST_P(QuadtreeTest, UpdateTest)
+{
+    checkUpdate(GetParam(), false);
+}
+
+TEST_P(QuadtreeTest, HashedUpdateTest)
+{
+    checkUpdate(GetParam(), true);
+}
+
+TEST_P(QuadtreeTest, HashedLocateTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(GetParam());
+    auto quadtree = Quadtree<Node*, GetBox>(box);
+    auto hashedQuadtree = Quadtree<Node*, GetBox>(box);
+    // Enable hashing before and after the insertions
+    hashedQuadtree.setHashingEnabled(true);
+    for (auto& node : nodes)
+    {
+        quadtree.add(&node);
+        hashedQuadtree.add(&node);
+    }
+    auto lateHashedQuadtree = Quadtree<Node*, GetBox>(box);
+    for (auto& node : nodes)
+        lateHashedQuadtree.add(&node);
+    lateHashedQuadtree.setHashingEnabled(true);
+    // Remove some nodes to trigger merges
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+    {
+        quadtree.remove(&nodes[i]);
+        hashedQuadtree.remove(&nodes[i]);
+        lateHashedQuadtree.remove(&nodes[i]);
+    }
+    auto generator = std::default_random_engine();
+    auto pointDistribution = std::uniform_real_distribution<float>(0.0f, 1.0f);
+    for (auto i = 0; i < 1000; ++i)
+    {
+        auto point = Vector2<float>(pointDistribution(generator), pointDistribution(generator));
+        auto code = quadtree.locate(point);
+        ASSERT_EQ(hashedQuadtree.locate(point), code);
+        ASSERT_EQ(lateHashedQuadtree.locate(point), code);
+    }
+    // Points on the boundaries of the cells and outside the area
+    for (auto point : {Vector2<float>(0.5f, 0.5f), Vector2<float>(0.25f, 0.75f), Vector2<float>(1.0f, 1.0f),
+        Vector2<float>(-1.0f, 0.5f), Vector2<float>(2.0f, 2.0f)})
+        ASSERT_EQ(hashedQuadtree.locate(point), quadtree.locate(point));
+    // Starting from the leaf of the query gives the same result
+    for (auto i = std::size_t(1); i < nodes.size(); i += 2)
+    {
+        auto predicate = [&nodes, i](Node* node, const Box<float>&){ return node != &nodes[i]; };
+        auto found = quadtree.findClosest(nodes[i].box, predicate);
+        auto hashedFound = hashedQuadtree.findClosest(nodes[i].box, predicate);
+        ASSERT_EQ(found == nullptr, hashedFound == nullptr);
+        if (found != nullptr)
+        {
+            ASSERT_FLOAT_EQ(distance((*found)->box, nodes[i].box), distance((*hashedFound)->box, nodes[i].box));
+        }
+    }
+}
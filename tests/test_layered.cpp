@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include "LayeredQuadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using LayeredQuadtreeType = LayeredQuadtree<Node*, GetBox>;
+
+// The nodes of odd id are static
+bool isStatic(const Node* node)
+{
+    return node->id % 2 == 1;
+}
+
+std::vector<std::pair<Node*, Node*>> findLayeredIntersections(std::vector<Node>& nodes)
+{
+    auto intersections = std::vector<std::pair<Node*, Node*>>();
+    for (const auto& intersection : findAllIntersections(nodes, std::vector<bool>()))
+    {
+        if (!isStatic(intersection.first) || !isStatic(intersection.second))
+            intersections.push_back(intersection);
+    }
+    return intersections;
+}
+
+void checkLayers(const LayeredQuadtreeType& quadtree, std::vector<Node>& nodes)
+{
+    for (const auto& node : nodes)
+    {
+        auto values = quadtree.query(node.box);
+        ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+            query(node.box, nodes, std::vector<bool>())));
+    }
+    auto intersections = quadtree.findAllIntersections();
+    auto expectedIntersections = findLayeredIntersections(nodes);
+    ASSERT_TRUE(checkIntersections(std::vector<std::pair<Node*, Node*>>(std::begin(intersections),
+        std::end(intersections)), expectedIntersections));
+    for (const auto& intersection : intersections)
+        ASSERT_FALSE(isStatic(intersection.first));
+    ThreadPool pool(3);
+    auto parallelIntersections = quadtree.findAllIntersections(pool);
+    ASSERT_EQ(parallelIntersections, intersections);
+    // The closest node is at the same distance as the one found by brute force
+    auto generator = std::default_random_engine();
+    auto pointDistribution = std::uniform_real_distribution<float>(0.0f, 1.0f);
+    for (auto i = 0; i < 10; ++i)
+    {
+        auto point = Box<float>(pointDistribution(generator), pointDistribution(generator), 0.0f, 0.0f);
+        auto closest = quadtree.findClosest(point);
+        if (nodes.empty())
+            ASSERT_EQ(closest, nullptr);
+        else
+        {
+            ASSERT_NE(closest, nullptr);
+            auto minDistance = std::numeric_limits<float>::max();
+            for (const auto& node : nodes)
+                minDistance = std::min(minDistance, distance(point, node.box));
+            ASSERT_EQ(distance(point, (*closest)->box), minDistance);
+        }
+    }
+}
+
+}
+
+TEST_P(QuadtreeTest, LayeredTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    auto quadtree = LayeredQuadtreeType(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    auto staticValues = std::vector<Node*>();
+    for (auto& node : nodes)
+    {
+        if (isStatic(&node))
+            staticValues.push_back(&node);
+        else
+            quadtree.add(&node);
+    }
+    quadtree.buildStatic(staticValues);
+    ASSERT_EQ(quadtree.getStaticLayer().query(quadtree.area()).size(), staticValues.size());
+    checkLayers(quadtree, nodes);
+    // Move the dynamic nodes
+    auto generator = std::default_random_engine();
+    auto displacementDistribution = std::uniform_real_distribution<float>(-0.01f, 0.01f);
+    for (auto& node : nodes)
+    {
+        if (isStatic(&node))
+            continue;
+        auto oldBox = node.box;
+        moveNode(node, generator, displacementDistribution);
+        quadtree.update(&node, oldBox);
+    }
+    checkLayers(quadtree, nodes);
+    // Rebuild the static layer, the nodes of the previous one are released with their blocks
+    quadtree.buildStatic(staticValues);
+    checkLayers(quadtree, nodes);
+}
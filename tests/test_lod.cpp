@@ -0,0 +1,215 @@
+#include <random>
+#include <thread>
+#include "gtest/gtest.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using NodeQuadtree = Quadtree<Node*, GetBox>;
+
+// Values whose path from the root goes through the cell, following the rules of getQuadrant
+bool isInSubtree(const Box<float>& cell, const Box<float>& box)
+{
+    return cell.contains(box) &&
+        (box.getRight() < cell.getRight() || cell.getRight() == 1.0f) &&
+        (box.getBottom() < cell.getBottom() || cell.getBottom() == 1.0f);
+}
+
+bool isInNode(const Box<float>& cell, const Box<float>& box)
+{
+    if (!isInSubtree(cell, box))
+        return false;
+    auto size = Vector2<float>(cell.width / 2.0f, cell.height / 2.0f);
+    for (auto origin : {cell.getTopLeft(), Vector2<float>(cell.left + size.x, cell.top),
+        Vector2<float>(cell.left, cell.top + size.y), cell.getTopLeft() + size})
+    {
+        if (isInSubtree(Box<float>(origin, size), box))
+            return false;
+    }
+    return true;
+}
+
+bool isSameBox(const Box<float>& lhs, const Box<float>& rhs)
+{
+    return lhs.left == rhs.left && lhs.top == rhs.top && lhs.width == rhs.width && lhs.height == rhs.height;
+}
+
+struct Aggregate
+{
+    std::size_t count = 0;
+    float left = 0.0f;
+    float top = 0.0f;
+    float right = 0.0f;
+    float bottom = 0.0f;
+
+    void add(const Box<float>& box)
+    {
+        left = count > 0 ? std::min(left, box.left) : box.left;
+        top = count > 0 ? std::min(top, box.top) : box.top;
+        right = count > 0 ? std::max(right, box.getRight()) : box.getRight();
+        bottom = count > 0 ? std::max(bottom, box.getBottom()) : box.getBottom();
+        ++count;
+    }
+
+    bool matches(const NodeQuadtree::NodeSummary& summary) const
+    {
+        auto isClose = [](float a, float b){ return std::abs(a - b) <= 1e-6f; };
+        return count == summary.count && isClose(left, summary.bounds.left) && isClose(top, summary.bounds.top) &&
+            isClose(right, summary.bounds.getRight()) && isClose(bottom, summary.bounds.getBottom());
+    }
+};
+
+void checkLod(const NodeQuadtree& quadtree, std::vector<Node>& nodes, const std::vector<bool>& removed,
+    const Box<float>& queryBox, std::size_t maxDepth)
+{
+    auto nbValues = std::size_t(0);
+    quadtree.queryLod(queryBox, maxDepth, [&](const NodeQuadtree::NodeSummary& summary)
+    {
+        ASSERT_TRUE(summary.box.intersects(queryBox));
+        ASSERT_LE(summary.depth, maxDepth);
+        ASSERT_NE(summary.representative, nullptr);
+        ASSERT_TRUE(isInSubtree(summary.box, (*summary.representative)->box));
+        // Brute force, the summary is either for the whole subtree or for the values of the node only
+        auto subtree = Aggregate();
+        auto own = Aggregate();
+        for (const auto& node : nodes)
+        {
+            if (!removed.empty() && removed[node.id])
+                continue;
+            if (isInSubtree(summary.box, node.box))
+                subtree.add(node.box);
+            if (isInNode(summary.box, node.box))
+                own.add(node.box);
+        }
+        if (summary.depth == maxDepth)
+            ASSERT_TRUE(subtree.matches(summary));
+        else
+            ASSERT_TRUE(subtree.matches(summary) || own.matches(summary));
+        nbValues += summary.count;
+    });
+    // The whole area covers all the values exactly once
+    if (queryBox.contains(quadtree.area()))
+    {
+        auto nbAlive = std::count(std::begin(removed), std::end(removed), false);
+        ASSERT_EQ(nbValues, removed.empty() ? nodes.size() : static_cast<std::size_t>(nbAlive));
+    }
+}
+
+}
+
+TEST_P(QuadtreeTest, LodTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(GetParam());
+    auto quadtree = NodeQuadtree(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (auto maxDepth = std::size_t(0); maxDepth <= 8; ++maxDepth)
+    {
+        checkLod(quadtree, nodes, {}, box, maxDepth);
+        checkLod(quadtree, nodes, {}, Box<float>(0.2f, 0.3f, 0.4f, 0.1f), maxDepth);
+    }
+    ASSERT_EQ(quadtree.getLodDepth(1.0f), 0);
+    ASSERT_EQ(quadtree.getLodDepth(0.25f), 2);
+    ASSERT_EQ(quadtree.getLodDepth(0.2f), 2);
+    ASSERT_EQ(quadtree.getLodDepth(0.0f), 8);
+}
+
+TEST_P(QuadtreeTest, LodRemoveAndUpdateTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(GetParam());
+    for (auto hashing : {false, true})
+    {
+        auto quadtree = NodeQuadtree(box);
+        quadtree.setHashingEnabled(hashing);
+        for (auto& node : nodes)
+            quadtree.add(&node);
+        auto removed = std::vector<bool>(nodes.size());
+        for (auto i = std::size_t(0); i < nodes.size(); i += 3)
+        {
+            quadtree.remove(&nodes[i]);
+            removed[i] = true;
+        }
+        // Shrink the remaining boxes so that the bounds must shrink
+        for (auto& node : nodes)
+        {
+            if (!removed[node.id])
+            {
+                auto oldBox = node.box;
+                node.box.width /= 2.0f;
+                node.box.left += node.box.width / 2.0f;
+                quadtree.update(&node, oldBox);
+            }
+        }
+        for (auto maxDepth = std::size_t(0); maxDepth <= 8; ++maxDepth)
+            checkLod(quadtree, nodes, removed, box, maxDepth);
+        // Restore the nodes for the next iteration
+        nodes = generateRandomNodes(GetParam());
+    }
+}
+
+TEST(LodTest, ConcurrentQueryLodTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(2000);
+    auto quadtree = NodeQuadtree(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Leave stale bounds for the concurrent queries to recompute
+    auto removed = std::vector<bool>(nodes.size());
+    for (auto i = std::size_t(0); i < nodes.size(); i += 3)
+    {
+        quadtree.remove(&nodes[i]);
+        removed[i] = true;
+    }
+    for (auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            auto oldBox = node.box;
+            node.box.width /= 2.0f;
+            quadtree.update(&node, oldBox);
+        }
+    }
+    const auto& constQuadtree = quadtree;
+    auto summaries = std::vector<std::vector<NodeQuadtree::NodeSummary>>(4);
+    auto threads = std::vector<std::thread>();
+    for (auto i = std::size_t(0); i < summaries.size(); ++i)
+    {
+        threads.emplace_back([&constQuadtree, &box, &summaries, i]()
+        {
+            for (auto maxDepth = std::size_t(0); maxDepth <= 8; ++maxDepth)
+            {
+                constQuadtree.queryLod(box, maxDepth, [&summaries, i](const NodeQuadtree::NodeSummary& summary)
+                {
+                    summaries[i].push_back(summary);
+                });
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    // Same summaries as a serial query
+    for (auto maxDepth = std::size_t(0); maxDepth <= 8; ++maxDepth)
+        checkLod(quadtree, nodes, removed, box, maxDepth);
+    auto expected = std::vector<NodeQuadtree::NodeSummary>();
+    for (auto maxDepth = std::size_t(0); maxDepth <= 8; ++maxDepth)
+        quadtree.queryLod(box, maxDepth, [&expected](const NodeQuadtree::NodeSummary& summary){ expected.push_back(summary); });
+    for (const auto& threadSummaries : summaries)
+    {
+        ASSERT_EQ(threadSummaries.size(), expected.size());
+        for (auto i = std::size_t(0); i < expected.size(); ++i)
+        {
+            ASSERT_TRUE(isSameBox(threadSummaries[i].box, expected[i].box));
+            ASSERT_TRUE(isSameBox(threadSummaries[i].bounds, expected[i].bounds));
+            ASSERT_EQ(threadSummaries[i].count, expected[i].count);
+            ASSERT_EQ(threadSummaries[i].representative, expected[i].representative);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using QuadtreeType = Quadtree<Node*, GetBox>;
+
+// Concentrate the nodes in a corner so that the tree is deep
+std::vector<Node> generateCornerNodes(std::size_t n)
+{
+    auto nodes = generateRandomNodes(n);
+    for (auto& node : nodes)
+    {
+        node.box.left *= 0.01f;
+        node.box.top *= 0.01f;
+        node.box.width *= 0.01f;
+        node.box.height *= 0.01f;
+    }
+    return nodes;
+}
+
+// Remove almost all the values and move the others, the deep subtrees are left underfull
+std::vector<bool> churn(QuadtreeType& quadtree, std::vector<Node>& nodes)
+{
+    auto generator = std::default_random_engine();
+    auto deathDistribution = std::uniform_int_distribution<int>(0, 99);
+    auto displacementDistribution = std::uniform_real_distribution<float>(-0.0001f, 0.0001f);
+    auto removed = std::vector<bool>(nodes.size());
+    for (auto& node : nodes)
+    {
+        removed[node.id] = deathDistribution(generator) != 0;
+        if (removed[node.id])
+            quadtree.remove(&node);
+        else
+        {
+            auto oldBox = node.box;
+            node.box.left = std::min(std::max(node.box.left + displacementDistribution(generator), 0.0f),
+                1.0f - node.box.width);
+            quadtree.update(&node, oldBox);
+        }
+    }
+    return removed;
+}
+
+void checkQuadtree(const QuadtreeType& quadtree, std::vector<Node>& nodes, const std::vector<bool>& removed)
+{
+    for (const auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            auto values = quadtree.query(node.box);
+            ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+                query(node.box, nodes, removed)));
+        }
+    }
+    auto intersections = quadtree.findAllIntersections();
+    ASSERT_TRUE(checkIntersections(std::vector<std::pair<Node*, Node*>>(std::begin(intersections), std::end(intersections)),
+        findAllIntersections(nodes, removed)));
+}
+
+}
+
+TEST_P(QuadtreeTest, MaintenanceTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    for (auto hashing : {false, true})
+    {
+        auto nodes = generateCornerNodes(GetParam());
+        auto quadtree = QuadtreeType(box);
+        quadtree.setHashingEnabled(hashing);
+        auto policy = QuadtreeType::MaintenancePolicy();
+        policy.enabled = true;
+        policy.collapseThreshold = 16;
+        quadtree.setMaintenancePolicy(policy);
+        for (auto& node : nodes)
+            quadtree.add(&node);
+        auto removed = churn(quadtree, nodes);
+        auto health = quadtree.getHealth();
+        ASSERT_EQ(health.nbUnderfullNodes, 0);
+        ASSERT_EQ(quadtree.getNbPendingCollapses(), 0);
+        checkQuadtree(quadtree, nodes, removed);
+        // The hash table follows the collapses
+        for (const auto& node : nodes)
+        {
+            auto code = quadtree.locate(node.box.getCenter());
+            auto nbLeaves = 0;
+            quadtree.forEachLeaf([code, &nbLeaves](auto leafCode, const auto&, const auto&)
+            {
+                if (leafCode == code)
+                    ++nbLeaves;
+            });
+            ASSERT_EQ(nbLeaves, 1);
+        }
+    }
+}
+
+TEST_P(QuadtreeTest, ManualMaintenanceTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateCornerNodes(GetParam());
+    auto quadtree = QuadtreeType(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto removed = churn(quadtree, nodes);
+    auto health = quadtree.getHealth();
+    // Enabling the policy finds the underfull nodes left by the churn
+    auto policy = QuadtreeType::MaintenancePolicy();
+    policy.enabled = true;
+    policy.collapseThreshold = 16;
+    policy.automatic = false;
+    quadtree.setMaintenancePolicy(policy);
+    ASSERT_LE(quadtree.getNbPendingCollapses(), health.nbUnderfullNodes);
+    ASSERT_EQ(quadtree.getNbPendingCollapses() > 0, health.nbUnderfullNodes > 0);
+    // Incrementally
+    while (quadtree.getNbPendingCollapses() > 0)
+    {
+        auto nbPendingCollapses = quadtree.getNbPendingCollapses();
+        ASSERT_EQ(quadtree.maintain(1), nbPendingCollapses - 1);
+        checkQuadtree(quadtree, nodes, removed);
+    }
+    auto maintainedHealth = quadtree.getHealth();
+    ASSERT_EQ(maintainedHealth.nbUnderfullNodes, 0);
+    ASSERT_LE(maintainedHealth.nbNodes, health.nbNodes);
+}
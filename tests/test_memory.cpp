@@ -0,0 +1,140 @@
+#include "gtest/gtest.h"
+#include "Grid.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+// Count the nodes allocated by the quadtrees
+std::size_t nbAllocatedObjects = 0;
+
+template <typename T>
+struct CountingMakeUnique
+{
+    template <typename... Args>
+    std::unique_ptr<T> operator() (Args&&... args)
+    {
+        ++nbAllocatedObjects;
+        return std::make_unique<T>(std::forward<Args>(args)...);
+    }
+};
+
+using QuadtreeType = Quadtree<Node*, GetBox>;
+using HybridQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, detail::StdMakeUnique, 4>;
+using CountingQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, CountingMakeUnique>;
+
+}
+
+TEST_P(QuadtreeTest, MemoryUsageTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(GetParam());
+    auto quadtree = QuadtreeType(box);
+    auto empty = quadtree.memoryUsage();
+    ASSERT_GT(empty.nodes, 0);
+    ASSERT_EQ(empty.values, 0);
+    ASSERT_EQ(empty.indexes, 0);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto usage = quadtree.memoryUsage();
+    ASSERT_EQ(usage.values, nodes.size() * sizeof(Node*));
+    ASSERT_GE(usage.nodes, empty.nodes);
+    ASSERT_EQ(usage.getTotal(), usage.nodes + usage.values + usage.slack + usage.indexes);
+    // The hash table is an auxiliary index
+    quadtree.setHashingEnabled(true);
+    auto hashedUsage = quadtree.memoryUsage();
+    ASSERT_GT(hashedUsage.indexes, usage.indexes);
+    ASSERT_EQ(hashedUsage.nodes, usage.nodes);
+    for (auto& node : nodes)
+        quadtree.remove(&node);
+    ASSERT_EQ(quadtree.memoryUsage().values, 0);
+}
+
+TEST_P(QuadtreeTest, GridMemoryUsageTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(GetParam());
+    auto grid = Grid<Node*, GetBox>(box);
+    for (auto& node : nodes)
+        grid.add(&node);
+    auto usage = grid.memoryUsage();
+    ASSERT_EQ(usage.nodes, 0);
+    ASSERT_EQ(usage.values, nodes.size() * sizeof(Node*));
+    // Each value has at least one entry in the cells
+    ASSERT_GE(usage.indexes, nodes.size() * sizeof(detail::CellIndex<float>::Entry));
+}
+
+TEST_P(QuadtreeTest, HybridMemoryUsageTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(GetParam());
+    // Concentrate the nodes in a corner so that the leaves at the maximum depth overflow
+    for (auto& node : nodes)
+    {
+        node.box.left *= 0.01f;
+        node.box.top *= 0.01f;
+        node.box.width *= 0.01f;
+        node.box.height *= 0.01f;
+    }
+    auto quadtree = HybridQuadtree(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto usage = quadtree.memoryUsage();
+    ASSERT_EQ(usage.values, nodes.size() * sizeof(Node*));
+    ASSERT_TRUE(nodes.size() <= 1000 || usage.indexes > 0);
+}
+
+TEST_P(QuadtreeTest, ReserveTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(GetParam());
+    // Without reserve
+    nbAllocatedObjects = 0;
+    auto quadtree = CountingQuadtree(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto nbAllocatedNodes = nbAllocatedObjects;
+    // With reserve, the splits take the reserved nodes
+    auto reservedQuadtree = CountingQuadtree(box);
+    reservedQuadtree.reserve(nodes.size());
+    ASSERT_GT(reservedQuadtree.memoryUsage().slack, 0);
+    nbAllocatedObjects = 0;
+    for (auto& node : nodes)
+        reservedQuadtree.add(&node);
+    ASSERT_LE(nbAllocatedObjects, nbAllocatedNodes - 1);
+    // The merged nodes go back to the reserve and are reused
+    auto removed = std::vector<bool>(nodes.size());
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+    {
+        removed[i] = true;
+        reservedQuadtree.remove(&nodes[i]);
+    }
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+    {
+        removed[i] = false;
+        reservedQuadtree.add(&nodes[i]);
+    }
+    for (auto i = std::size_t(0); i < nodes.size(); i += 3)
+    {
+        removed[i] = true;
+        reservedQuadtree.remove(&nodes[i]);
+    }
+    for (const auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            auto values = reservedQuadtree.query(node.box);
+            ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+                query(node.box, nodes, removed)));
+        }
+    }
+    // Release everything that is not used
+    reservedQuadtree.shrinkToFit();
+    auto usage = reservedQuadtree.memoryUsage();
+    ASSERT_EQ(usage.slack, 0);
+    ASSERT_EQ(usage.values, (nodes.size() - (nodes.size() + 2) / 3) * sizeof(Node*));
+}
@@ -0,0 +1,82 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using NodeQuadtree = Quadtree<Node*, GetBox>;
+
+struct Leaf
+{
+    NodeQuadtree::LocationalCode code;
+    Box<float> box;
+    std::size_t nbValues;
+};
+
+bool touches(const Box<float>& a, const Box<float>& b)
+{
+    return !(a.getRight() < b.left || b.getRight() < a.left || a.getBottom() < b.top || b.getBottom() < a.top);
+}
+
+void checkNeighbours(std::size_t n, bool hashing)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto quadtree = NodeQuadtree(box);
+    quadtree.setHashingEnabled(hashing);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (auto i = std::size_t(0); i < nodes.size(); i += 3)
+        quadtree.remove(&nodes[i]);
+    // Leaves
+    auto leaves = std::vector<Leaf>();
+    auto nbValues = std::size_t(0);
+    quadtree.forEachLeaf([&leaves, &nbValues](auto code, const Box<float>& leafBox, const auto& values)
+    {
+        leaves.push_back(Leaf{code, leafBox, values.size()});
+        nbValues += values.size();
+    });
+    ASSERT_LE(nbValues, nodes.size() - (nodes.size() + 2) / 3);
+    for (const auto& leaf : leaves)
+        ASSERT_EQ(quadtree.locate(leaf.box.getCenter()), leaf.code);
+    // Neighbours
+    for (const auto& leaf : leaves)
+    {
+        auto neighbours = std::vector<NodeQuadtree::LocationalCode>();
+        quadtree.forEachNeighbour(leaf.code, [&neighbours, &leaves](auto code, const Box<float>& neighbourBox, const auto& values)
+        {
+            auto it = std::find_if(std::begin(leaves), std::end(leaves), [code](const Leaf& other){ return other.code == code; });
+            ASSERT_NE(it, std::end(leaves));
+            ASSERT_EQ(it->nbValues, values.size());
+            ASSERT_FLOAT_EQ(it->box.left, neighbourBox.left);
+            ASSERT_FLOAT_EQ(it->box.top, neighbourBox.top);
+            neighbours.push_back(code);
+        });
+        auto expectedNeighbours = std::vector<NodeQuadtree::LocationalCode>();
+        for (const auto& other : leaves)
+        {
+            if (other.code != leaf.code && touches(leaf.box, other.box))
+                expectedNeighbours.push_back(other.code);
+        }
+        std::sort(std::begin(neighbours), std::end(neighbours));
+        std::sort(std::begin(expectedNeighbours), std::end(expectedNeighbours));
+        ASSERT_EQ(neighbours, expectedNeighbours);
+    }
+}
+
+}
+
+TEST_P(QuadtreeTest, NeighboursTest)
+{
+    checkNeighbours(GetParam(), false);
+}
+
+TEST_P(QuadtreeTest, HashedNeighboursTest)
+{
+    checkNeighbours(GetParam(), true);
+}
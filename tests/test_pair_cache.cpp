@@ -0,0 +1,133 @@
+#include <map>
+#include <set>
+#include "gtest/gtest.h"
+#include "PairCache.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using Pair = std::pair<Node*, Node*>;
+
+Pair canonicalise(const Pair& pair)
+{
+    return std::less<Node*>()(pair.second, pair.first) ? Pair(pair.second, pair.first) : pair;
+}
+
+}
+
+TEST_P(QuadtreeTest, PairCacheTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    auto quadtree = Quadtree<Node*, GetBox>(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // The data counts the updates that found the pair
+    auto cache = PairCache<Node*, int>();
+    auto previousPairs = std::set<Pair>();
+    auto generator = std::default_random_engine();
+    auto displacementDistribution = std::uniform_real_distribution<float>(-0.02f, 0.02f);
+    for (auto frame = 0; frame < 5; ++frame)
+    {
+        auto intersections = quadtree.findAllIntersections();
+        auto pairs = std::set<Pair>();
+        for (const auto& intersection : intersections)
+            pairs.insert(canonicalise(intersection));
+        auto begun = std::set<Pair>();
+        auto persisted = std::set<Pair>();
+        auto ended = std::set<Pair>();
+        cache.update(intersections,
+            [&begun](Node* a, Node* b, int& count){ ASSERT_EQ(count, 0); ++count; begun.insert(Pair(a, b)); },
+            [&persisted](Node* a, Node* b, int& count){ ++count; persisted.insert(Pair(a, b)); },
+            [&ended](Node* a, Node* b, int&){ ended.insert(Pair(a, b)); });
+        for (const auto& pair : pairs)
+        {
+            ASSERT_EQ(persisted.count(pair), previousPairs.count(pair));
+            ASSERT_EQ(begun.count(pair), 1 - previousPairs.count(pair));
+        }
+        ASSERT_EQ(begun.size() + persisted.size(), pairs.size());
+        for (const auto& pair : previousPairs)
+            ASSERT_EQ(ended.count(pair), 1 - pairs.count(pair));
+        ASSERT_EQ(ended.size() + persisted.size(), previousPairs.size());
+        ASSERT_EQ(cache.size(), pairs.size());
+        for (const auto& pair : ended)
+            ASSERT_EQ(cache.find(pair.first, pair.second), nullptr);
+        // The order of the values does not matter
+        for (const auto& pair : persisted)
+        {
+            auto count = cache.find(pair.second, pair.first);
+            ASSERT_TRUE(count != nullptr && *count >= 2);
+        }
+        previousPairs = pairs;
+        for (auto& node : nodes)
+        {
+            auto oldBox = node.box;
+            moveNode(node, generator, displacementDistribution);
+            quadtree.update(&node, oldBox);
+        }
+    }
+}
+
+TEST(PairCacheTest, ChurnTest)
+{
+    // Few values to have long clusters and many removals in them
+    auto cache = PairCache<int, int>();
+    auto expected = std::map<std::pair<int, int>, int>();
+    auto generator = std::default_random_engine();
+    auto valueDistribution = std::uniform_int_distribution<int>(0, 200);
+    for (auto frame = 1; frame <= 50; ++frame)
+    {
+        auto pairs = std::vector<std::pair<int, int>>();
+        // Keep some of the previous pairs and add new ones
+        for (const auto& pair : expected)
+        {
+            if (valueDistribution(generator) < 150)
+                pairs.push_back(frame % 2 == 0 ? pair.first : std::make_pair(pair.first.second, pair.first.first));
+        }
+        for (auto i = 0; i < 1000; ++i)
+            pairs.emplace_back(valueDistribution(generator), valueDistribution(generator));
+        auto nextExpected = std::map<std::pair<int, int>, int>();
+        for (auto pair : pairs)
+        {
+            if (pair.second < pair.first)
+                std::swap(pair.first, pair.second);
+            auto it = expected.find(pair);
+            nextExpected[pair] = it != expected.end() ? it->second : frame;
+        }
+        cache.update(pairs, [frame](int, int, int& data){ data = frame; }, [](int, int, int&){}, [](int, int, int&){});
+        expected = std::move(nextExpected);
+        ASSERT_EQ(cache.size(), expected.size());
+        for (const auto& pair : expected)
+        {
+            auto data = cache.find(pair.first.first, pair.first.second);
+            ASSERT_NE(data, nullptr);
+            ASSERT_EQ(*data, pair.second);
+        }
+        auto nbPairs = std::size_t(0);
+        cache.forEach([&nbPairs, &expected](int a, int b, int&)
+        {
+            ASSERT_EQ(expected.count(std::make_pair(a, b)), 1);
+            ++nbPairs;
+        });
+        ASSERT_EQ(nbPairs, expected.size());
+    }
+    cache.update(std::vector<std::pair<int, int>>());
+    ASSERT_TRUE(cache.empty());
+}
+
+TEST(PairCacheTest, ReserveTest)
+{
+    auto cache = PairCache<int, int>();
+    cache.reserve(1000);
+    auto usage = cache.memoryUsage();
+    auto pairs = std::vector<std::pair<int, int>>();
+    for (auto i = 0; i < 1000; ++i)
+        pairs.emplace_back(i, i + 1);
+    cache.update(pairs);
+    ASSERT_EQ(cache.size(), 1000);
+    ASSERT_EQ(cache.memoryUsage().getTotal(), usage.getTotal());
+}
@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+#include "BlockMakeUnique.h"
+#include "Executor.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using QuadtreeType = Quadtree<Node*, GetBox>;
+using BlockQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, BlockMakeUnique>;
+
+template <typename Executor, typename Container = QuadtreeType>
+void checkParallelOperations(std::vector<Node>& nodes, Executor& executor, bool hashing, bool reserve = false)
+{
+    auto values = std::vector<Node*>();
+    for (auto& node : nodes)
+        values.push_back(&node);
+    auto quadtree = Container(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    quadtree.setHashingEnabled(hashing);
+    if (reserve)
+        quadtree.reserve(nodes.size());
+    quadtree.build(values, executor);
+    // Batch query
+    auto boxes = std::vector<Box<float>>();
+    for (const auto& node : nodes)
+        boxes.push_back(node.box);
+    auto results = quadtree.query(boxes, executor);
+    ASSERT_EQ(results.size(), boxes.size());
+    for (auto i = std::size_t(0); i < boxes.size(); ++i)
+    {
+        ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(results[i]), std::end(results[i])),
+            query(boxes[i], nodes, std::vector<bool>())));
+    }
+    // Parallel intersections
+    auto intersections = quadtree.findAllIntersections(executor);
+    ASSERT_TRUE(checkIntersections(std::vector<std::pair<Node*, Node*>>(std::begin(intersections),
+        std::end(intersections)), findAllIntersections(nodes, std::vector<bool>())));
+    // The built quadtree supports the other operations
+    auto removed = std::vector<bool>(nodes.size());
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+    {
+        quadtree.remove(&nodes[i]);
+        removed[i] = true;
+    }
+    auto queryBox = Box<float>(0.2f, 0.3f, 0.5f, 0.4f);
+    auto queried = quadtree.query(queryBox);
+    ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(queried), std::end(queried)),
+        query(queryBox, nodes, removed)));
+}
+
+}
+
+TEST_P(QuadtreeTest, SequentialExecutorTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    auto executor = SequentialExecutor();
+    checkParallelOperations(nodes, executor, false);
+}
+
+TEST_P(QuadtreeTest, ThreadExecutorTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    auto executor = ThreadExecutor(3);
+    checkParallelOperations(nodes, executor, false);
+}
+
+TEST_P(QuadtreeTest, ThreadPoolTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    ThreadPool executor(3);
+    checkParallelOperations(nodes, executor, false);
+    checkParallelOperations(nodes, executor, true);
+}
+
+TEST_P(QuadtreeTest, ReservedBuildTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    ThreadPool executor(3);
+    checkParallelOperations(nodes, executor, false, true);
+    // The tasks allocate through copies of a policy shared between the threads
+    checkParallelOperations<ThreadPool, BlockQuadtree>(nodes, executor, true, true);
+}
+
+#if defined(__cpp_lib_execution) && defined(TEST_EXECUTION_POLICIES)
+TEST_P(QuadtreeTest, PolicyExecutorTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    auto executor = PolicyExecutor<std::execution::parallel_policy>(std::execution::par);
+    checkParallelOperations(nodes, executor, false);
+}
+#endif
+
+TEST(ThreadPoolTest, ReuseTest)
+{
+    ThreadPool pool(4);
+    ASSERT_EQ(pool.getConcurrency(), 4);
+    for (auto n : {0ul, 1ul, 3ul, 100ul, 1000ul})
+    {
+        auto counts = std::vector<int>(n);
+        pool.parallelFor(n, [&counts](std::size_t i){ ++counts[i]; });
+        ASSERT_EQ(counts, std::vector<int>(n, 1));
+    }
+}
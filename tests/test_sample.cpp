@@ -0,0 +1,68 @@
+#include <map>
+#include <random>
+#include "gtest/gtest.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using NodeQuadtree = Quadtree<Node*, GetBox>;
+
+void checkSample(const NodeQuadtree& quadtree, std::vector<Node>& nodes, const std::vector<bool>& removed,
+    const Box<float>& box)
+{
+    auto generator = std::default_random_engine();
+    auto expected = query(box, nodes, removed);
+    auto nbSamples = 50 * expected.size() + 10;
+    auto samples = quadtree.sample(box, nbSamples, generator);
+    if (expected.empty())
+    {
+        ASSERT_TRUE(samples.empty());
+        return;
+    }
+    ASSERT_EQ(samples.size(), nbSamples);
+    auto frequencies = std::map<Node*, std::size_t>();
+    for (auto node : samples)
+    {
+        ASSERT_TRUE(box.intersects(node->box));
+        ASSERT_TRUE(removed.empty() || !removed[node->id]);
+        ++frequencies[node];
+    }
+    // Each value is expected 50 times, check that none is far from it
+    for (auto node : expected)
+    {
+        ASSERT_GE(frequencies[node], 15);
+        ASSERT_LE(frequencies[node], 100);
+    }
+}
+
+}
+
+TEST_P(QuadtreeTest, SampleTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(std::min<std::size_t>(GetParam(), 1000));
+    auto quadtree = NodeQuadtree(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    checkSample(quadtree, nodes, {}, box);
+    checkSample(quadtree, nodes, {}, Box<float>(0.1f, 0.2f, 0.3f, 0.4f));
+    checkSample(quadtree, nodes, {}, Box<float>(0.5f, 0.5f, 0.001f, 0.001f));
+    // Remove some nodes
+    auto removed = std::vector<bool>(nodes.size());
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+    {
+        quadtree.remove(&nodes[i]);
+        removed[i] = true;
+    }
+    checkSample(quadtree, nodes, removed, box);
+    checkSample(quadtree, nodes, removed, Box<float>(0.6f, 0.1f, 0.2f, 0.7f));
+    // Degenerate cases
+    auto generator = std::default_random_engine();
+    ASSERT_TRUE(quadtree.sample(box, 0, generator).empty());
+    ASSERT_TRUE(quadtree.sample(Box<float>(2.0f, 2.0f, 1.0f, 1.0f), 10, generator).empty());
+}
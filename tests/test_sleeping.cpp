@@ -0,0 +1,191 @@
+#include "gtest/gtest.h"
+#include "SleepingQuadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using SleepingQuadtreeType = SleepingQuadtree<Node*, GetBox>;
+
+std::vector<std::pair<Node*, Node*>> findAwakeIntersections(std::vector<Node>& nodes, const std::vector<bool>& awake)
+{
+    auto intersections = std::vector<std::pair<Node*, Node*>>();
+    for (const auto& intersection : findAllIntersections(nodes, std::vector<bool>()))
+    {
+        if (awake[intersection.first->id] || awake[intersection.second->id])
+            intersections.push_back(intersection);
+    }
+    return intersections;
+}
+
+void checkLayers(const SleepingQuadtreeType& quadtree, std::vector<Node>& nodes, const std::vector<bool>& awake)
+{
+    for (auto& node : nodes)
+    {
+        ASSERT_EQ(quadtree.isAwake(&node), awake[node.id]);
+        ASSERT_EQ(quadtree.getAwakeLayer().contains(&node), awake[node.id]);
+        ASSERT_EQ(quadtree.getSleepingLayer().contains(&node), !awake[node.id]);
+    }
+    auto intersections = quadtree.findAllIntersections();
+    ASSERT_TRUE(checkIntersections(std::vector<std::pair<Node*, Node*>>(std::begin(intersections),
+        std::end(intersections)), findAwakeIntersections(nodes, awake)));
+    // The awake value comes first in the pairs with a sleeping value
+    for (const auto& intersection : intersections)
+        ASSERT_TRUE(awake[intersection.first->id]);
+    auto queryBox = Box<float>(0.2f, 0.3f, 0.5f, 0.4f);
+    auto values = quadtree.query(queryBox);
+    ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+        query(queryBox, nodes, std::vector<bool>())));
+}
+
+}
+
+TEST_P(QuadtreeTest, SleepingTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    auto quadtree = SleepingQuadtreeType(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    // One node in four is awake
+    auto awake = std::vector<bool>(nodes.size());
+    for (auto& node : nodes)
+    {
+        awake[node.id] = node.id % 4 == 0;
+        quadtree.add(&node, awake[node.id]);
+    }
+    checkLayers(quadtree, nodes, awake);
+    // Put some nodes to sleep and wake others
+    for (auto& node : nodes)
+    {
+        if (node.id % 8 == 0)
+        {
+            quadtree.sleep(&node);
+            awake[node.id] = false;
+        }
+        else if (node.id % 8 == 1)
+        {
+            quadtree.wake(&node);
+            awake[node.id] = true;
+        }
+    }
+    checkLayers(quadtree, nodes, awake);
+    // Waking an awake node or putting a sleeping node to sleep does nothing
+    for (auto& node : nodes)
+    {
+        if (awake[node.id])
+            quadtree.wake(&node);
+        else
+            quadtree.sleep(&node);
+    }
+    checkLayers(quadtree, nodes, awake);
+    // Move all the nodes, in both layers
+    auto generator = std::default_random_engine();
+    auto displacementDistribution = std::uniform_real_distribution<float>(-0.01f, 0.01f);
+    for (auto& node : nodes)
+    {
+        auto oldBox = node.box;
+        moveNode(node, generator, displacementDistribution);
+        quadtree.update(&node, oldBox);
+    }
+    checkLayers(quadtree, nodes, awake);
+    // The sleeping nodes touched by an awake node are reported and woken during the search
+    auto touched = std::vector<bool>(nodes.size());
+    auto nbTouchingPairs = std::size_t(0);
+    for (const auto& intersection : findAwakeIntersections(nodes, awake))
+    {
+        if (awake[intersection.first->id] != awake[intersection.second->id])
+            ++nbTouchingPairs;
+        for (auto node : {intersection.first, intersection.second})
+            touched[node->id] = !awake[node->id];
+    }
+    auto wasAwake = awake;
+    auto nbReportedPairs = std::size_t(0);
+    auto executor = SequentialExecutor();
+    auto intersections = quadtree.findAllIntersections(executor,
+        [&quadtree, &awake, &wasAwake, &nbReportedPairs](Node* awakeNode, Node* sleepingNode)
+        {
+            EXPECT_TRUE(wasAwake[awakeNode->id]);
+            EXPECT_FALSE(wasAwake[sleepingNode->id]);
+            ++nbReportedPairs;
+            if (!awake[sleepingNode->id])
+            {
+                quadtree.wake(sleepingNode);
+                awake[sleepingNode->id] = true;
+            }
+        });
+    ASSERT_TRUE(checkIntersections(std::vector<std::pair<Node*, Node*>>(std::begin(intersections),
+        std::end(intersections)), findAwakeIntersections(nodes, wasAwake)));
+    ASSERT_EQ(nbReportedPairs, nbTouchingPairs);
+    for (const auto& node : nodes)
+        ASSERT_EQ(awake[node.id], wasAwake[node.id] || touched[node.id]);
+    checkLayers(quadtree, nodes, awake);
+    // Remove half of the nodes
+    auto removed = std::vector<bool>(nodes.size());
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+    {
+        quadtree.remove(&nodes[i]);
+        removed[i] = true;
+    }
+    auto values = quadtree.query(quadtree.area());
+    ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+        query(quadtree.area(), nodes, removed)));
+}
+
+TEST_P(QuadtreeTest, ContainsTest)
+{
+    auto nodes = generateRandomNodes(GetParam());
+    auto quadtree = Quadtree<Node*, GetBox>(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+        quadtree.add(&nodes[i]);
+    for (auto i = std::size_t(0); i < nodes.size(); ++i)
+        ASSERT_EQ(quadtree.contains(&nodes[i]), i % 2 == 0);
+}
+
+TEST(SleepingTest, RestingContactTest)
+{
+    auto nodes = std::vector<Node>{
+        {Box<float>(0.1f, 0.1f, 0.2f, 0.2f), 0},
+        {Box<float>(0.2f, 0.2f, 0.2f, 0.2f), 1},
+        {Box<float>(0.7f, 0.7f, 0.1f, 0.1f), 2}};
+    auto quadtree = SleepingQuadtreeType(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    quadtree.add(&nodes[0], true);
+    quadtree.add(&nodes[1], false);
+    quadtree.add(&nodes[2], false);
+    auto executor = SequentialExecutor();
+    auto reported = std::vector<std::pair<Node*, Node*>>();
+    auto onTouched = [&reported](Node* awakeNode, Node* sleepingNode){ reported.emplace_back(awakeNode, sleepingNode); };
+    // The resting contact is reported once while it lasts, and found at each call
+    for (auto i = 0; i < 3; ++i)
+        ASSERT_EQ(quadtree.findAllIntersections(executor, onTouched).size(), 1);
+    ASSERT_EQ(reported.size(), 1);
+    ASSERT_EQ(reported.front().first, &nodes[0]);
+    ASSERT_EQ(reported.front().second, &nodes[1]);
+    // The contact ends, then starts again
+    auto oldBox = nodes[0].box;
+    nodes[0].box.left = 0.5f;
+    quadtree.update(&nodes[0], oldBox);
+    quadtree.findAllIntersections(executor, onTouched);
+    ASSERT_EQ(reported.size(), 1);
+    oldBox = nodes[0].box;
+    nodes[0].box.left = 0.1f;
+    quadtree.update(&nodes[0], oldBox);
+    quadtree.findAllIntersections(executor, onTouched);
+    quadtree.findAllIntersections(executor, onTouched);
+    ASSERT_EQ(reported.size(), 2);
+    // Once woken the node is not touched anymore, once asleep again it is newly touched
+    quadtree.wake(&nodes[1]);
+    quadtree.findAllIntersections(executor, onTouched);
+    ASSERT_EQ(reported.size(), 2);
+    quadtree.sleep(&nodes[1]);
+    quadtree.findAllIntersections(executor, onTouched);
+    ASSERT_EQ(reported.size(), 3);
+    // The other overloads do not consume the new contacts
+    quadtree.sleep(&nodes[0]);
+    quadtree.wake(&nodes[1]);
+    ASSERT_EQ(quadtree.findAllIntersections().size(), 1);
+    quadtree.findAllIntersections(executor, onTouched);
+    ASSERT_EQ(reported.size(), 4);
+    ASSERT_EQ(reported.back().first, &nodes[1]);
+    ASSERT_EQ(reported.back().second, &nodes[0]);
+}
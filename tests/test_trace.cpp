@@ -0,0 +1,175 @@
+#include <sstream>
+#include <thread>
+#include "gtest/gtest.h"
+#include "Quadtree.h"
+#include "Trace.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+using RecordedQuadtree = Quadtree<Node*, GetBox, std::equal_to<Node*>, float, std::allocator, detail::StdMakeUnique,
+    0, 16, 8, TraceRecorder<float>>;
+
+bool isSame(const Box<float>& a, const Box<float>& b)
+{
+    return a.left == b.left && a.top == b.top && a.width == b.width && a.height == b.height;
+}
+
+}
+
+TEST_P(QuadtreeTest, TraceTest)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(GetParam());
+    auto stream = std::stringstream();
+    auto quadtree = RecordedQuadtree(box);
+    // Not recorded
+    quadtree.add(&nodes[0]);
+    quadtree.remove(&nodes[0]);
+    // Recorded
+    quadtree.getRecorder().setStream(&stream, quadtree.area());
+    auto expected = std::vector<TraceEvent<float>>();
+    for (auto& node : nodes)
+    {
+        quadtree.add(&node);
+        expected.push_back(TraceEvent<float>{TraceOperation::Add, node.box, Box<float>()});
+    }
+    for (auto& node : nodes)
+    {
+        auto values = quadtree.query(node.box);
+        ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+            query(node.box, nodes, {})));
+        expected.push_back(TraceEvent<float>{TraceOperation::Query, node.box, Box<float>()});
+    }
+    for (auto& node : nodes)
+    {
+        auto oldBox = node.box;
+        node.box.left /= 2.0f;
+        quadtree.update(&node, oldBox);
+        expected.push_back(TraceEvent<float>{TraceOperation::Update, node.box, oldBox});
+    }
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+    expected.push_back(TraceEvent<float>{TraceOperation::FindAllIntersections, Box<float>(), Box<float>()});
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+    {
+        quadtree.remove(&nodes[i]);
+        expected.push_back(TraceEvent<float>{TraceOperation::Remove, nodes[i].box, Box<float>()});
+    }
+    // Read the trace back
+    auto reader = TraceReader<float>(stream);
+    ASSERT_TRUE(reader.isValid());
+    ASSERT_TRUE(isSame(reader.getArea(), box));
+    auto event = TraceEvent<float>();
+    for (const auto& expectedEvent : expected)
+    {
+        ASSERT_TRUE(reader.read(event));
+        ASSERT_EQ(event.operation, expectedEvent.operation);
+        if (event.operation != TraceOperation::FindAllIntersections)
+        {
+            ASSERT_TRUE(isSame(event.box, expectedEvent.box));
+        }
+        if (event.operation == TraceOperation::Update)
+        {
+            ASSERT_TRUE(isSame(event.oldBox, expectedEvent.oldBox));
+        }
+    }
+    ASSERT_FALSE(reader.read(event));
+}
+
+TEST(TraceTest, InvalidTraceTest)
+{
+    auto stream = std::stringstream("QTTR");
+    ASSERT_FALSE(TraceReader<float>(stream).isValid());
+    // Previous version without the area
+    auto oldStream = std::stringstream(std::string("QTTR\x01\x04", 6));
+    ASSERT_FALSE(TraceReader<float>(oldStream).isValid());
+    auto doubleStream = std::stringstream();
+    auto recorder = TraceRecorder<double>();
+    recorder.setStream(&doubleStream, Box<double>(0.0, 0.0, 1.0, 1.0));
+    recorder.onAdd(Box<double>(0.0, 0.0, 1.0, 1.0));
+    ASSERT_FALSE(TraceReader<float>(doubleStream).isValid());
+    // Truncated
+    auto truncatedStream = std::stringstream();
+    auto floatRecorder = TraceRecorder<float>();
+    floatRecorder.setStream(&truncatedStream, Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    floatRecorder.onAdd(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    auto data = truncatedStream.str();
+    truncatedStream.str(data.substr(0, data.size() - 1));
+    auto reader = TraceReader<float>(truncatedStream);
+    ASSERT_TRUE(reader.isValid());
+    auto event = TraceEvent<float>();
+    ASSERT_FALSE(reader.read(event));
+}
+
+TEST(TraceTest, AreaTest)
+{
+    // Values in world coordinates, far from the unit box
+    auto area = Box<float>(-2000.0f, 500.0f, 4000.0f, 3000.0f);
+    auto nodes = generateRandomNodes(1000);
+    for (auto& node : nodes)
+    {
+        node.box.left = area.left + node.box.left * area.width;
+        node.box.top = area.top + node.box.top * area.height;
+        node.box.width *= area.width;
+        node.box.height *= area.height;
+    }
+    auto stream = std::stringstream();
+    auto quadtree = RecordedQuadtree(area);
+    quadtree.getRecorder().setStream(&stream, quadtree.area());
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Replay the trace in a quadtree of the recorded area
+    auto reader = TraceReader<float>(stream);
+    ASSERT_TRUE(reader.isValid());
+    ASSERT_TRUE(isSame(reader.getArea(), area));
+    auto replayedNodes = std::vector<Node>(nodes.size());
+    auto replayed = Quadtree<Node*, GetBox>(reader.getArea());
+    auto event = TraceEvent<float>();
+    for (auto& node : replayedNodes)
+    {
+        ASSERT_TRUE(reader.read(event));
+        ASSERT_EQ(event.operation, TraceOperation::Add);
+        node.box = event.box;
+        replayed.add(&node);
+    }
+    ASSERT_FALSE(reader.read(event));
+    ASSERT_EQ(replayed.findAllIntersections().size(), quadtree.findAllIntersections().size());
+}
+
+TEST(TraceTest, ConcurrentQueriesTest)
+{
+    auto nodes = generateRandomNodes(1000);
+    auto stream = std::stringstream();
+    auto quadtree = RecordedQuadtree(Box<float>(0.0f, 0.0f, 1.0f, 1.0f));
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    quadtree.getRecorder().setStream(&stream, quadtree.area());
+    // Concurrent queries on the const quadtree, each one must be recorded whole
+    const auto& constQuadtree = quadtree;
+    auto threads = std::vector<std::thread>();
+    for (auto i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&constQuadtree, &nodes]()
+        {
+            for (const auto& node : nodes)
+                constQuadtree.query(node.box);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    auto reader = TraceReader<float>(stream);
+    ASSERT_TRUE(reader.isValid());
+    auto event = TraceEvent<float>();
+    auto nbQueries = std::size_t(0);
+    while (reader.read(event))
+    {
+        ASSERT_EQ(event.operation, TraceOperation::Query);
+        ++nbQueries;
+    }
+    ASSERT_TRUE(reader.isValid());
+    ASSERT_EQ(nbQueries, 4 * nodes.size());
+}
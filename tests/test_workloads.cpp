@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+#include "Quadtree.h"
+#include "quadtree_test.hpp"
+#include "brute_force.hpp"
+
+using namespace quadtree;
+
+namespace
+{
+
+bool isSame(const Box<float>& a, const Box<float>& b)
+{
+    return a.left == b.left && a.top == b.top && a.width == b.width && a.height == b.height;
+}
+
+void checkWorkload(std::vector<Node>& nodes)
+{
+    auto box = Box<float>(0.0f, 0.0f, 1.0f, 1.0f);
+    auto quadtree = Quadtree<Node*, GetBox>(box);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (const auto& node : nodes)
+    {
+        auto values = quadtree.query(node.box);
+        ASSERT_TRUE(checkIntersections(std::vector<Node*>(std::begin(values), std::end(values)),
+            query(node.box, nodes, {})));
+    }
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+    // Remove half of the nodes
+    auto removed = std::vector<bool>(nodes.size());
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+    {
+        quadtree.remove(&nodes[i]);
+        removed[i] = true;
+    }
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, removed)));
+}
+
+}
+
+TEST_P(QuadtreeTest, WorkloadsTest)
+{
+    auto n = std::min<std::size_t>(GetParam(), 1000);
+    for (auto distribution : workloads::Distributions)
+    {
+        auto parameters = workloads::Parameters();
+        parameters.distribution = distribution;
+        auto nodes = workloads::generateNodes(n, parameters);
+        ASSERT_EQ(nodes.size(), n);
+        for (auto i = std::size_t(0); i < n; ++i)
+        {
+            ASSERT_EQ(nodes[i].id, i);
+            ASSERT_TRUE(Box<float>(0.0f, 0.0f, 1.0f, 1.0f).contains(nodes[i].box));
+        }
+        // Same seed, same workload
+        auto sameNodes = workloads::generateNodes(n, parameters);
+        for (auto i = std::size_t(0); i < n; ++i)
+            ASSERT_TRUE(isSame(nodes[i].box, sameNodes[i].box));
+        checkWorkload(nodes);
+    }
+}
+
+TEST(WorkloadsTest, SeedTest)
+{
+    auto parameters = workloads::Parameters();
+    for (auto distribution : workloads::Distributions)
+    {
+        if (distribution == workloads::Distribution::Grid)
+            continue;
+        parameters.distribution = distribution;
+        parameters.seed = 1;
+        auto nodes1 = workloads::generateNodes(100, parameters);
+        parameters.seed = 2;
+        auto nodes2 = workloads::generateNodes(100, parameters);
+        auto nbDifferent = std::count_if(std::begin(nodes1), std::end(nodes1),
+            [&nodes2](const Node& node){ return !isSame(node.box, nodes2[node.id].box); });
+        ASSERT_GT(nbDifferent, 90);
+    }
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "Box.h"
+
+// Seeded generators of boxes in the unit square shared by the benchmarks,
+// the examples and the tests
+
+namespace workloads
+{
+
+struct Node
+{
+    quadtree::Box<float> box;
+    std::size_t id;
+};
+
+enum class Distribution
+{
+    Uniform, // Uniform positions and sizes up to maxSize
+    Clustered, // Gaussian clusters around random centers
+    Gaussian, // A single gaussian around the center of the square
+    Lines, // Along random segments, like roads
+    Grid, // On a regular lattice, in row-major order
+    PowerLaw // Uniform positions, power law sizes with a few huge boxes
+};
+
+constexpr auto Distributions = std::array<Distribution, 6>{
+    Distribution::Uniform,
+    Distribution::Clustered,
+    Distribution::Gaussian,
+    Distribution::Lines,
+    Distribution::Grid,
+    Distribution::PowerLaw
+};
+
+inline const char* getName(Distribution distribution)
+{
+    switch (distribution)
+    {
+        case Distribution::Uniform:
+            return "uniform";
+        case Distribution::Clustered:
+            return "clustered";
+        case Distribution::Gaussian:
+            return "gaussian";
+        case Distribution::Lines:
+            return "lines";
+        case Distribution::Grid:
+            return "grid";
+        case Distribution::PowerLaw:
+            return "powerlaw";
+        default:
+            return "unknown";
+    }
+}
+
+struct Parameters
+{
+    Distribution distribution = Distribution::Uniform;
+    std::default_random_engine::result_type seed = std::default_random_engine::default_seed;
+    // Maximum width and height of the boxes
+    float maxSize = 0.01f;
+    // Clustered
+    std::size_t nbClusters = 16;
+    float clusterDeviation = 0.02f;
+    // Gaussian
+    float deviation = 0.15f;
+    // Lines
+    std::size_t nbLines = 32;
+    float lineDeviation = 0.002f;
+    // Power law, the sizes follow a Pareto distribution of minimum minSize
+    float minSize = 0.001f;
+    float exponent = 2.0f;
+    float maxHugeSize = 0.5f;
+};
+
+namespace detail
+{
+
+inline float clampPosition(float x)
+{
+    return std::min(std::max(x, 0.0f), std::nextafter(1.0f, 0.0f));
+}
+
+// Keep the box in the unit square
+inline quadtree::Box<float> makeBox(float left, float top, float width, float height)
+{
+    left = clampPosition(left);
+    top = clampPosition(top);
+    return quadtree::Box<float>(left, top, std::min(1.0f - left, width), std::min(1.0f - top, height));
+}
+
+}
+
+inline std::vector<Node> generateNodes(std::size_t n, const Parameters& parameters = Parameters())
+{
+    auto generator = std::default_random_engine(parameters.seed);
+    auto unitDistribution = std::uniform_real_distribution<float>(0.0f, 1.0f);
+    auto sizeDistribution = std::uniform_real_distribution<float>(0.0f, parameters.maxSize);
+    auto nodes = std::vector<Node>(n);
+    switch (parameters.distribution)
+    {
+        case Distribution::Uniform:
+            for (auto& node : nodes)
+            {
+                auto left = unitDistribution(generator);
+                auto top = unitDistribution(generator);
+                auto width = sizeDistribution(generator);
+                auto height = sizeDistribution(generator);
+                node.box = detail::makeBox(left, top, width, height);
+            }
+            break;
+        case Distribution::Clustered:
+        {
+            auto centers = std::vector<quadtree::Vector2<float>>(std::max<std::size_t>(parameters.nbClusters, 1));
+            for (auto& center : centers)
+                center = quadtree::Vector2<float>(unitDistribution(generator), unitDistribution(generator));
+            auto clusterDistribution = std::uniform_int_distribution<std::size_t>(0, centers.size() - 1);
+            auto offsetDistribution = std::normal_distribution<float>(0.0f, parameters.clusterDeviation);
+            for (auto& node : nodes)
+            {
+                const auto& center = centers[clusterDistribution(generator)];
+                auto left = center.x + offsetDistribution(generator);
+                auto top = center.y + offsetDistribution(generator);
+                node.box = detail::makeBox(left, top, sizeDistribution(generator), sizeDistribution(generator));
+            }
+            break;
+        }
+        case Distribution::Gaussian:
+        {
+            auto offsetDistribution = std::normal_distribution<float>(0.5f, parameters.deviation);
+            for (auto& node : nodes)
+            {
+                auto left = offsetDistribution(generator);
+                auto top = offsetDistribution(generator);
+                node.box = detail::makeBox(left, top, sizeDistribution(generator), sizeDistribution(generator));
+            }
+            break;
+        }
+        case Distribution::Lines:
+        {
+            auto lines = std::vector<std::array<float, 4>>(std::max<std::size_t>(parameters.nbLines, 1));
+            for (auto& line : lines)
+                std::generate(std::begin(line), std::end(line), [&](){ return unitDistribution(generator); });
+            auto lineDistribution = std::uniform_int_distribution<std::size_t>(0, lines.size() - 1);
+            auto offsetDistribution = std::normal_distribution<float>(0.0f, parameters.lineDeviation);
+            for (auto& node : nodes)
+            {
+                const auto& line = lines[lineDistribution(generator)];
+                auto t = unitDistribution(generator);
+                auto left = line[0] + t * (line[2] - line[0]) + offsetDistribution(generator);
+                auto top = line[1] + t * (line[3] - line[1]) + offsetDistribution(generator);
+                node.box = detail::makeBox(left, top, sizeDistribution(generator), sizeDistribution(generator));
+            }
+            break;
+        }
+        case Distribution::Grid:
+        {
+            auto nbColumns = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(n))));
+            auto spacing = 1.0f / static_cast<float>(std::max<std::size_t>(nbColumns, 1));
+            auto size = std::min(parameters.maxSize, spacing / 2.0f);
+            for (auto i = std::size_t(0); i < n; ++i)
+            {
+                auto left = static_cast<float>(i % nbColumns) * spacing;
+                auto top = static_cast<float>(i / nbColumns) * spacing;
+                nodes[i].box = detail::makeBox(left, top, size, size);
+            }
+            break;
+        }
+        case Distribution::PowerLaw:
+        {
+            auto drawSize = [&]()
+            {
+                auto u = unitDistribution(generator);
+                auto size = parameters.minSize * std::pow(1.0f - u, -1.0f / (parameters.exponent - 1.0f));
+                return std::min(size, parameters.maxHugeSize);
+            };
+            for (auto& node : nodes)
+            {
+                auto left = unitDistribution(generator);
+                auto top = unitDistribution(generator);
+                auto width = drawSize();
+                auto height = drawSize();
+                node.box = detail::makeBox(left, top, width, height);
+            }
+            break;
+        }
+    }
+    for (auto i = std::size_t(0); i < n; ++i)
+        nodes[i].id = i;
+    return nodes;
+}
+
+inline std::vector<Node> generateNodes(std::size_t n, Distribution distribution)
+{
+    auto parameters = Parameters();
+    parameters.distribution = distribution;
+    return generateNodes(n, parameters);
+}
+
+// Uniform boxes with the default seed
+inline std::vector<Node> generateRandomNodes(std::size_t n)
+{
+    return generateNodes(n, Distribution::Uniform);
+}
+
+// Move a node by a random displacement and keep it in the unit square
+inline void moveNode(Node& node, std::default_random_engine& generator,
+    std::uniform_real_distribution<float>& displacementDistribution)
+{
+    node.box.left = std::min(std::max(node.box.left + displacementDistribution(generator), 0.0f),
+        1.0f - node.box.width);
+    node.box.top = std::min(std::max(node.box.top + displacementDistribution(generator), 0.0f),
+        1.0f - node.box.height);
+}
+
+}